@@ -5,8 +5,134 @@
 
 using namespace Rcpp;
 
+// barStoreWriteInterface
+void barStoreWriteInterface(std::string path, SEXP indexIn, SEXP dataIn, int indexType, int generation);
+RcppExport SEXP btutils_barStoreWriteInterface(SEXP pathSEXP, SEXP indexInSEXP, SEXP dataInSEXP, SEXP indexTypeSEXP, SEXP generationSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type indexIn(indexInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type dataIn(dataInSEXP);
+    Rcpp::traits::input_parameter< int >::type indexType(indexTypeSEXP);
+    Rcpp::traits::input_parameter< int >::type generation(generationSEXP);
+    barStoreWriteInterface(path, indexIn, dataIn, indexType, generation);
+    return R_NilValue;
+END_RCPP
+}
+// barStoreOpenInterface
+SEXP barStoreOpenInterface(std::string path);
+RcppExport SEXP btutils_barStoreOpenInterface(SEXP pathSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    __result = Rcpp::wrap(barStoreOpenInterface(path));
+    return __result;
+END_RCPP
+}
+// barStoreReadInterface
+Rcpp::List barStoreReadInterface(SEXP storeIn);
+RcppExport SEXP btutils_barStoreReadInterface(SEXP storeInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type storeIn(storeInSEXP);
+    __result = Rcpp::wrap(barStoreReadInterface(storeIn));
+    return __result;
+END_RCPP
+}
+// barStoreBarsInterface
+int barStoreBarsInterface(SEXP storeIn);
+RcppExport SEXP btutils_barStoreBarsInterface(SEXP storeInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type storeIn(storeInSEXP);
+    __result = Rcpp::wrap(barStoreBarsInterface(storeIn));
+    return __result;
+END_RCPP
+}
+// barStoreGenerationInterface
+int barStoreGenerationInterface(SEXP storeIn);
+RcppExport SEXP btutils_barStoreGenerationInterface(SEXP storeInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type storeIn(storeInSEXP);
+    __result = Rcpp::wrap(barStoreGenerationInterface(storeIn));
+    return __result;
+END_RCPP
+}
+// barStoreIndexInterface
+Rcpp::List barStoreIndexInterface(SEXP storeIn);
+RcppExport SEXP btutils_barStoreIndexInterface(SEXP storeInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type storeIn(storeInSEXP);
+    __result = Rcpp::wrap(barStoreIndexInterface(storeIn));
+    return __result;
+END_RCPP
+}
+// bootstrapReturnsInterface
+Rcpp::List bootstrapReturnsInterface(SEXP returnsIn, int samples, int blockLength, bool compound, double scale, SEXP probsIn, double seed, int threads);
+RcppExport SEXP btutils_bootstrapReturnsInterface(SEXP returnsInSEXP, SEXP samplesSEXP, SEXP blockLengthSEXP, SEXP compoundSEXP, SEXP scaleSEXP, SEXP probsInSEXP, SEXP seedSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type returnsIn(returnsInSEXP);
+    Rcpp::traits::input_parameter< int >::type samples(samplesSEXP);
+    Rcpp::traits::input_parameter< int >::type blockLength(blockLengthSEXP);
+    Rcpp::traits::input_parameter< bool >::type compound(compoundSEXP);
+    Rcpp::traits::input_parameter< double >::type scale(scaleSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type probsIn(probsInSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(bootstrapReturnsInterface(returnsIn, samples, blockLength, compound, scale, probsIn, seed, threads));
+    return __result;
+END_RCPP
+}
+// compactIndicatorInterface
+Rcpp::RawVector compactIndicatorInterface(SEXP indicatorIn);
+RcppExport SEXP btutils_compactIndicatorInterface(SEXP indicatorInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type indicatorIn(indicatorInSEXP);
+    __result = Rcpp::wrap(compactIndicatorInterface(indicatorIn));
+    return __result;
+END_RCPP
+}
+// expandIndicatorInterface
+Rcpp::NumericVector expandIndicatorInterface(SEXP indicatorIn);
+RcppExport SEXP btutils_expandIndicatorInterface(SEXP indicatorInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type indicatorIn(indicatorInSEXP);
+    __result = Rcpp::wrap(expandIndicatorInterface(indicatorIn));
+    return __result;
+END_RCPP
+}
+// capTradeDurationRunsInterface
+Rcpp::List capTradeDurationRunsInterface(SEXP lengthsIn, SEXP valuesIn, int shortMinCap, int longMinCap, int shortMaxCap, int longMaxCap, bool waitNewSignal);
+RcppExport SEXP btutils_capTradeDurationRunsInterface(SEXP lengthsInSEXP, SEXP valuesInSEXP, SEXP shortMinCapSEXP, SEXP longMinCapSEXP, SEXP shortMaxCapSEXP, SEXP longMaxCapSEXP, SEXP waitNewSignalSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type lengthsIn(lengthsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type valuesIn(valuesInSEXP);
+    Rcpp::traits::input_parameter< int >::type shortMinCap(shortMinCapSEXP);
+    Rcpp::traits::input_parameter< int >::type longMinCap(longMinCapSEXP);
+    Rcpp::traits::input_parameter< int >::type shortMaxCap(shortMaxCapSEXP);
+    Rcpp::traits::input_parameter< int >::type longMaxCap(longMaxCapSEXP);
+    Rcpp::traits::input_parameter< bool >::type waitNewSignal(waitNewSignalSEXP);
+    __result = Rcpp::wrap(capTradeDurationRunsInterface(lengthsIn, valuesIn, shortMinCap, longMinCap, shortMaxCap, longMaxCap, waitNewSignal));
+    return __result;
+END_RCPP
+}
 // capTradeDurationInterface
-Rcpp::NumericVector capTradeDurationInterface(SEXP indicatorIn, int shortMinCap, int longMinCap, int shortMaxCap, int longMaxCap, bool waitNewSignal);
+SEXP capTradeDurationInterface(SEXP indicatorIn, int shortMinCap, int longMinCap, int shortMaxCap, int longMaxCap, bool waitNewSignal);
 RcppExport SEXP btutils_capTradeDurationInterface(SEXP indicatorInSEXP, SEXP shortMinCapSEXP, SEXP longMinCapSEXP, SEXP shortMaxCapSEXP, SEXP longMaxCapSEXP, SEXP waitNewSignalSEXP) {
 BEGIN_RCPP
     Rcpp::RObject __result;
@@ -22,8 +148,39 @@ BEGIN_RCPP
 END_RCPP
 }
 // constructIndicatorInterface
-Rcpp::NumericVector constructIndicatorInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn);
-RcppExport SEXP btutils_constructIndicatorInterface(SEXP longEntriesInSEXP, SEXP longExitsInSEXP, SEXP shortEntriesInSEXP, SEXP shortExitsInSEXP) {
+SEXP constructIndicatorInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn, bool compact);
+RcppExport SEXP btutils_constructIndicatorInterface(SEXP longEntriesInSEXP, SEXP longExitsInSEXP, SEXP shortEntriesInSEXP, SEXP shortExitsInSEXP, SEXP compactSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type longEntriesIn(longEntriesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type longExitsIn(longExitsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type shortEntriesIn(shortEntriesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type shortExitsIn(shortExitsInSEXP);
+    Rcpp::traits::input_parameter< bool >::type compact(compactSEXP);
+    __result = Rcpp::wrap(constructIndicatorInterface(longEntriesIn, longExitsIn, shortEntriesIn, shortExitsIn, compact));
+    return __result;
+END_RCPP
+}
+// constructIndicatorsInterface
+SEXP constructIndicatorsInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn, bool compact, int threads);
+RcppExport SEXP btutils_constructIndicatorsInterface(SEXP longEntriesInSEXP, SEXP longExitsInSEXP, SEXP shortEntriesInSEXP, SEXP shortExitsInSEXP, SEXP compactSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type longEntriesIn(longEntriesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type longExitsIn(longExitsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type shortEntriesIn(shortEntriesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type shortExitsIn(shortExitsInSEXP);
+    Rcpp::traits::input_parameter< bool >::type compact(compactSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(constructIndicatorsInterface(longEntriesIn, longExitsIn, shortEntriesIn, shortExitsIn, compact, threads));
+    return __result;
+END_RCPP
+}
+// constructIndicatorRunsInterface
+Rcpp::List constructIndicatorRunsInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn);
+RcppExport SEXP btutils_constructIndicatorRunsInterface(SEXP longEntriesInSEXP, SEXP longExitsInSEXP, SEXP shortEntriesInSEXP, SEXP shortExitsInSEXP) {
 BEGIN_RCPP
     Rcpp::RObject __result;
     Rcpp::RNGScope __rngScope;
@@ -31,7 +188,7 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< SEXP >::type longExitsIn(longExitsInSEXP);
     Rcpp::traits::input_parameter< SEXP >::type shortEntriesIn(shortEntriesInSEXP);
     Rcpp::traits::input_parameter< SEXP >::type shortExitsIn(shortExitsInSEXP);
-    __result = Rcpp::wrap(constructIndicatorInterface(longEntriesIn, longExitsIn, shortEntriesIn, shortExitsIn));
+    __result = Rcpp::wrap(constructIndicatorRunsInterface(longEntriesIn, longExitsIn, shortEntriesIn, shortExitsIn));
     return __result;
 END_RCPP
 }
@@ -47,6 +204,18 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// indicatorFromTrendlineRunsInterface
+Rcpp::List indicatorFromTrendlineRunsInterface(SEXP trendlineIn, SEXP thresholdsIn);
+RcppExport SEXP btutils_indicatorFromTrendlineRunsInterface(SEXP trendlineInSEXP, SEXP thresholdsInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type trendlineIn(trendlineInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type thresholdsIn(thresholdsInSEXP);
+    __result = Rcpp::wrap(indicatorFromTrendlineRunsInterface(trendlineIn, thresholdsIn));
+    return __result;
+END_RCPP
+}
 // zigZagInterface
 Rcpp::List zigZagInterface(SEXP pricesIn, SEXP changesIn, bool percent);
 RcppExport SEXP btutils_zigZagInterface(SEXP pricesInSEXP, SEXP changesInSEXP, SEXP percentSEXP) {
@@ -60,6 +229,60 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// zigZagMultiInterface
+Rcpp::List zigZagMultiInterface(SEXP pricesIn, SEXP changesIn, bool percent, bool withIndicator, bool withInflections, bool withTargets, bool withCorrections, bool withAge, int threads);
+RcppExport SEXP btutils_zigZagMultiInterface(SEXP pricesInSEXP, SEXP changesInSEXP, SEXP percentSEXP, SEXP withIndicatorSEXP, SEXP withInflectionsSEXP, SEXP withTargetsSEXP, SEXP withCorrectionsSEXP, SEXP withAgeSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type pricesIn(pricesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type changesIn(changesInSEXP);
+    Rcpp::traits::input_parameter< bool >::type percent(percentSEXP);
+    Rcpp::traits::input_parameter< bool >::type withIndicator(withIndicatorSEXP);
+    Rcpp::traits::input_parameter< bool >::type withInflections(withInflectionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type withTargets(withTargetsSEXP);
+    Rcpp::traits::input_parameter< bool >::type withCorrections(withCorrectionsSEXP);
+    Rcpp::traits::input_parameter< bool >::type withAge(withAgeSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(zigZagMultiInterface(pricesIn, changesIn, percent, withIndicator, withInflections, withTargets, withCorrections, withAge, threads));
+    return __result;
+END_RCPP
+}
+// zigZagTrackerInterface
+SEXP zigZagTrackerInterface(bool percent);
+RcppExport SEXP btutils_zigZagTrackerInterface(SEXP percentSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< bool >::type percent(percentSEXP);
+    __result = Rcpp::wrap(zigZagTrackerInterface(percent));
+    return __result;
+END_RCPP
+}
+// zigZagUpdateInterface
+Rcpp::IntegerVector zigZagUpdateInterface(SEXP trackerIn, SEXP pricesIn, SEXP changesIn);
+RcppExport SEXP btutils_zigZagUpdateInterface(SEXP trackerInSEXP, SEXP pricesInSEXP, SEXP changesInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type trackerIn(trackerInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type pricesIn(pricesInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type changesIn(changesInSEXP);
+    __result = Rcpp::wrap(zigZagUpdateInterface(trackerIn, pricesIn, changesIn));
+    return __result;
+END_RCPP
+}
+// zigZagStateInterface
+Rcpp::List zigZagStateInterface(SEXP trackerIn);
+RcppExport SEXP btutils_zigZagStateInterface(SEXP trackerInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type trackerIn(trackerInSEXP);
+    __result = Rcpp::wrap(zigZagStateInterface(trackerIn));
+    return __result;
+END_RCPP
+}
 // processTradeInterface
 Rcpp::List processTradeInterface(SEXP opIn, SEXP hiIn, SEXP loIn, SEXP clIn, int ibeg, int iend, int pos, double stopLoss, double stopTrailing, double profitTarget, int maxDays, double tickSize);
 RcppExport SEXP btutils_processTradeInterface(SEXP opInSEXP, SEXP hiInSEXP, SEXP loInSEXP, SEXP clInSEXP, SEXP ibegSEXP, SEXP iendSEXP, SEXP posSEXP, SEXP stopLossSEXP, SEXP stopTrailingSEXP, SEXP profitTargetSEXP, SEXP maxDaysSEXP, SEXP tickSizeSEXP) {
@@ -82,9 +305,52 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// tradeTrackerInterface
+SEXP tradeTrackerInterface(double entryPrice, int pos, double stopLoss, double stopTrailing, double profitTarget, int maxDays, double tickSize);
+RcppExport SEXP btutils_tradeTrackerInterface(SEXP entryPriceSEXP, SEXP posSEXP, SEXP stopLossSEXP, SEXP stopTrailingSEXP, SEXP profitTargetSEXP, SEXP maxDaysSEXP, SEXP tickSizeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< double >::type entryPrice(entryPriceSEXP);
+    Rcpp::traits::input_parameter< int >::type pos(posSEXP);
+    Rcpp::traits::input_parameter< double >::type stopLoss(stopLossSEXP);
+    Rcpp::traits::input_parameter< double >::type stopTrailing(stopTrailingSEXP);
+    Rcpp::traits::input_parameter< double >::type profitTarget(profitTargetSEXP);
+    Rcpp::traits::input_parameter< int >::type maxDays(maxDaysSEXP);
+    Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
+    __result = Rcpp::wrap(tradeTrackerInterface(entryPrice, pos, stopLoss, stopTrailing, profitTarget, maxDays, tickSize));
+    return __result;
+END_RCPP
+}
+// trackerUpdateInterface
+bool trackerUpdateInterface(SEXP trackerIn, double op, double hi, double lo, double cl);
+RcppExport SEXP btutils_trackerUpdateInterface(SEXP trackerInSEXP, SEXP opSEXP, SEXP hiSEXP, SEXP loSEXP, SEXP clSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type trackerIn(trackerInSEXP);
+    Rcpp::traits::input_parameter< double >::type op(opSEXP);
+    Rcpp::traits::input_parameter< double >::type hi(hiSEXP);
+    Rcpp::traits::input_parameter< double >::type lo(loSEXP);
+    Rcpp::traits::input_parameter< double >::type cl(clSEXP);
+    __result = Rcpp::wrap(trackerUpdateInterface(trackerIn, op, hi, lo, cl));
+    return __result;
+END_RCPP
+}
+// trackerStateInterface
+Rcpp::List trackerStateInterface(SEXP trackerIn);
+RcppExport SEXP btutils_trackerStateInterface(SEXP trackerInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type trackerIn(trackerInSEXP);
+    __result = Rcpp::wrap(trackerStateInterface(trackerIn));
+    return __result;
+END_RCPP
+}
 // processTradesInterface
-Rcpp::List processTradesInterface(SEXP ohlcIn, SEXP ibegsIn, SEXP iendsIn, SEXP positionIn, SEXP stopLossIn, SEXP stopTrailingIn, SEXP profitTargetIn, SEXP maxDaysIn, double tickSize);
-RcppExport SEXP btutils_processTradesInterface(SEXP ohlcInSEXP, SEXP ibegsInSEXP, SEXP iendsInSEXP, SEXP positionInSEXP, SEXP stopLossInSEXP, SEXP stopTrailingInSEXP, SEXP profitTargetInSEXP, SEXP maxDaysInSEXP, SEXP tickSizeSEXP) {
+Rcpp::List processTradesInterface(SEXP ohlcIn, SEXP ibegsIn, SEXP iendsIn, SEXP positionIn, SEXP stopLossIn, SEXP stopTrailingIn, SEXP profitTargetIn, SEXP maxDaysIn, double tickSize, SEXP indexIn, int threads);
+RcppExport SEXP btutils_processTradesInterface(SEXP ohlcInSEXP, SEXP ibegsInSEXP, SEXP iendsInSEXP, SEXP positionInSEXP, SEXP stopLossInSEXP, SEXP stopTrailingInSEXP, SEXP profitTargetInSEXP, SEXP maxDaysInSEXP, SEXP tickSizeSEXP, SEXP indexInSEXP, SEXP threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject __result;
     Rcpp::RNGScope __rngScope;
@@ -97,7 +363,42 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< SEXP >::type profitTargetIn(profitTargetInSEXP);
     Rcpp::traits::input_parameter< SEXP >::type maxDaysIn(maxDaysInSEXP);
     Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
-    __result = Rcpp::wrap(processTradesInterface(ohlcIn, ibegsIn, iendsIn, positionIn, stopLossIn, stopTrailingIn, profitTargetIn, maxDaysIn, tickSize));
+    Rcpp::traits::input_parameter< SEXP >::type indexIn(indexInSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(processTradesInterface(ohlcIn, ibegsIn, iendsIn, positionIn, stopLossIn, stopTrailingIn, profitTargetIn, maxDaysIn, tickSize, indexIn, threads));
+    return __result;
+END_RCPP
+}
+// sweepTradesInterface
+Rcpp::List sweepTradesInterface(SEXP ohlcIn, SEXP ibegsIn, SEXP iendsIn, SEXP positionIn, SEXP stopLossIn, SEXP stopTrailingIn, SEXP profitTargetIn, SEXP maxDaysIn, double tickSize, bool useIndex, int threads);
+RcppExport SEXP btutils_sweepTradesInterface(SEXP ohlcInSEXP, SEXP ibegsInSEXP, SEXP iendsInSEXP, SEXP positionInSEXP, SEXP stopLossInSEXP, SEXP stopTrailingInSEXP, SEXP profitTargetInSEXP, SEXP maxDaysInSEXP, SEXP tickSizeSEXP, SEXP useIndexSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type ohlcIn(ohlcInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type ibegsIn(ibegsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type iendsIn(iendsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type positionIn(positionInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type stopLossIn(stopLossInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type stopTrailingIn(stopTrailingInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type profitTargetIn(profitTargetInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type maxDaysIn(maxDaysInSEXP);
+    Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type useIndex(useIndexSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(sweepTradesInterface(ohlcIn, ibegsIn, iendsIn, positionIn, stopLossIn, stopTrailingIn, profitTargetIn, maxDaysIn, tickSize, useIndex, threads));
+    return __result;
+END_RCPP
+}
+// tradesFromRunsInterface
+Rcpp::List tradesFromRunsInterface(SEXP lengthsIn, SEXP valuesIn);
+RcppExport SEXP btutils_tradesFromRunsInterface(SEXP lengthsInSEXP, SEXP valuesInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type lengthsIn(lengthsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type valuesIn(valuesInSEXP);
+    __result = Rcpp::wrap(tradesFromRunsInterface(lengthsIn, valuesIn));
     return __result;
 END_RCPP
 }
@@ -128,15 +429,167 @@ BEGIN_RCPP
     return __result;
 END_RCPP
 }
+// returnStatsInterface
+Rcpp::DataFrame returnStatsInterface(SEXP returnsIn, double periods, bool inDollars, int threads);
+RcppExport SEXP btutils_returnStatsInterface(SEXP returnsInSEXP, SEXP periodsSEXP, SEXP inDollarsSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type returnsIn(returnsInSEXP);
+    Rcpp::traits::input_parameter< double >::type periods(periodsSEXP);
+    Rcpp::traits::input_parameter< bool >::type inDollars(inDollarsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(returnStatsInterface(returnsIn, periods, inDollars, threads));
+    return __result;
+END_RCPP
+}
+// tradeIndicatorInterface
+Rcpp::List tradeIndicatorInterface(SEXP ohlcIn, SEXP indicatorIn, double stopLoss, double stopTrailing, double profitTarget, int maxDays, double tickSize, bool withReturns, bool inDollars, SEXP indexIn, int threads);
+RcppExport SEXP btutils_tradeIndicatorInterface(SEXP ohlcInSEXP, SEXP indicatorInSEXP, SEXP stopLossSEXP, SEXP stopTrailingSEXP, SEXP profitTargetSEXP, SEXP maxDaysSEXP, SEXP tickSizeSEXP, SEXP withReturnsSEXP, SEXP inDollarsSEXP, SEXP indexInSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type ohlcIn(ohlcInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type indicatorIn(indicatorInSEXP);
+    Rcpp::traits::input_parameter< double >::type stopLoss(stopLossSEXP);
+    Rcpp::traits::input_parameter< double >::type stopTrailing(stopTrailingSEXP);
+    Rcpp::traits::input_parameter< double >::type profitTarget(profitTargetSEXP);
+    Rcpp::traits::input_parameter< int >::type maxDays(maxDaysSEXP);
+    Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type withReturns(withReturnsSEXP);
+    Rcpp::traits::input_parameter< bool >::type inDollars(inDollarsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type indexIn(indexInSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(tradeIndicatorInterface(ohlcIn, indicatorIn, stopLoss, stopTrailing, profitTarget, maxDays, tickSize, withReturns, inDollars, indexIn, threads));
+    return __result;
+END_RCPP
+}
+// tradeIndicatorsInterface
+Rcpp::List tradeIndicatorsInterface(SEXP ohlcsIn, SEXP indicatorsIn, double stopLoss, double stopTrailing, double profitTarget, int maxDays, double tickSize, bool withReturns, bool inDollars, int threads);
+RcppExport SEXP btutils_tradeIndicatorsInterface(SEXP ohlcsInSEXP, SEXP indicatorsInSEXP, SEXP stopLossSEXP, SEXP stopTrailingSEXP, SEXP profitTargetSEXP, SEXP maxDaysSEXP, SEXP tickSizeSEXP, SEXP withReturnsSEXP, SEXP inDollarsSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type ohlcsIn(ohlcsInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type indicatorsIn(indicatorsInSEXP);
+    Rcpp::traits::input_parameter< double >::type stopLoss(stopLossSEXP);
+    Rcpp::traits::input_parameter< double >::type stopTrailing(stopTrailingSEXP);
+    Rcpp::traits::input_parameter< double >::type profitTarget(profitTargetSEXP);
+    Rcpp::traits::input_parameter< int >::type maxDays(maxDaysSEXP);
+    Rcpp::traits::input_parameter< double >::type tickSize(tickSizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type withReturns(withReturnsSEXP);
+    Rcpp::traits::input_parameter< bool >::type inDollars(inDollarsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(tradeIndicatorsInterface(ohlcsIn, indicatorsIn, stopLoss, stopTrailing, profitTarget, maxDays, tickSize, withReturns, inDollars, threads));
+    return __result;
+END_RCPP
+}
+// profilingResetInterface
+void profilingResetInterface();
+RcppExport SEXP btutils_profilingResetInterface() {
+BEGIN_RCPP
+    Rcpp::RNGScope __rngScope;
+    profilingResetInterface();
+    return R_NilValue;
+END_RCPP
+}
+// profilingEnableInterface
+bool profilingEnableInterface(bool enable);
+RcppExport SEXP btutils_profilingEnableInterface(SEXP enableSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< bool >::type enable(enableSEXP);
+    __result = Rcpp::wrap(profilingEnableInterface(enable));
+    return __result;
+END_RCPP
+}
+// profilingCountersInterface
+Rcpp::List profilingCountersInterface();
+RcppExport SEXP btutils_profilingCountersInterface() {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    __result = Rcpp::wrap(profilingCountersInterface());
+    return __result;
+END_RCPP
+}
+// rangeIndexInterface
+SEXP rangeIndexInterface(SEXP ohlcIn);
+RcppExport SEXP btutils_rangeIndexInterface(SEXP ohlcInSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type ohlcIn(ohlcInSEXP);
+    __result = Rcpp::wrap(rangeIndexInterface(ohlcIn));
+    return __result;
+END_RCPP
+}
+// syntheticOhlcInterface
+Rcpp::NumericMatrix syntheticOhlcInterface(int bars, double start, double volatility, double seed, int threads);
+RcppExport SEXP btutils_syntheticOhlcInterface(SEXP barsSEXP, SEXP startSEXP, SEXP volatilitySEXP, SEXP seedSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< int >::type bars(barsSEXP);
+    Rcpp::traits::input_parameter< double >::type start(startSEXP);
+    Rcpp::traits::input_parameter< double >::type volatility(volatilitySEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(syntheticOhlcInterface(bars, start, volatility, seed, threads));
+    return __result;
+END_RCPP
+}
+// syntheticTradesInterface
+Rcpp::DataFrame syntheticTradesInterface(int bars, int trades, int minDuration, int maxDuration, double seed);
+RcppExport SEXP btutils_syntheticTradesInterface(SEXP barsSEXP, SEXP tradesSEXP, SEXP minDurationSEXP, SEXP maxDurationSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< int >::type bars(barsSEXP);
+    Rcpp::traits::input_parameter< int >::type trades(tradesSEXP);
+    Rcpp::traits::input_parameter< int >::type minDuration(minDurationSEXP);
+    Rcpp::traits::input_parameter< int >::type maxDuration(maxDurationSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    __result = Rcpp::wrap(syntheticTradesInterface(bars, trades, minDuration, maxDuration, seed));
+    return __result;
+END_RCPP
+}
+// syntheticIndicatorInterface
+Rcpp::NumericVector syntheticIndicatorInterface(int bars, double meanDuration, bool withFlat, double seed);
+RcppExport SEXP btutils_syntheticIndicatorInterface(SEXP barsSEXP, SEXP meanDurationSEXP, SEXP withFlatSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< int >::type bars(barsSEXP);
+    Rcpp::traits::input_parameter< double >::type meanDuration(meanDurationSEXP);
+    Rcpp::traits::input_parameter< bool >::type withFlat(withFlatSEXP);
+    Rcpp::traits::input_parameter< double >::type seed(seedSEXP);
+    __result = Rcpp::wrap(syntheticIndicatorInterface(bars, meanDuration, withFlat, seed));
+    return __result;
+END_RCPP
+}
 // locfInterface
-Rcpp::NumericVector locfInterface(SEXP vin, double value);
-RcppExport SEXP btutils_locfInterface(SEXP vinSEXP, SEXP valueSEXP) {
+Rcpp::NumericVector locfInterface(SEXP vin, double value, int threads);
+RcppExport SEXP btutils_locfInterface(SEXP vinSEXP, SEXP valueSEXP, SEXP threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject __result;
     Rcpp::RNGScope __rngScope;
     Rcpp::traits::input_parameter< SEXP >::type vin(vinSEXP);
     Rcpp::traits::input_parameter< double >::type value(valueSEXP);
-    __result = Rcpp::wrap(locfInterface(vin, value));
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(locfInterface(vin, value, threads));
+    return __result;
+END_RCPP
+}
+// leadingNARows
+int leadingNARows(SEXP vin);
+RcppExport SEXP btutils_leadingNARows(SEXP vinSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type vin(vinSEXP);
+    __result = Rcpp::wrap(leadingNARows(vin));
     return __result;
 END_RCPP
 }
@@ -152,26 +605,83 @@ BEGIN_RCPP
 END_RCPP
 }
 // laguerreFilterInterface
-Rcpp::NumericVector laguerreFilterInterface(SEXP vin, double gamma);
-RcppExport SEXP btutils_laguerreFilterInterface(SEXP vinSEXP, SEXP gammaSEXP) {
+Rcpp::NumericVector laguerreFilterInterface(SEXP vin, double gamma, int threads);
+RcppExport SEXP btutils_laguerreFilterInterface(SEXP vinSEXP, SEXP gammaSEXP, SEXP threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject __result;
     Rcpp::RNGScope __rngScope;
     Rcpp::traits::input_parameter< SEXP >::type vin(vinSEXP);
     Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
-    __result = Rcpp::wrap(laguerreFilterInterface(vin, gamma));
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(laguerreFilterInterface(vin, gamma, threads));
     return __result;
 END_RCPP
 }
 // laguerreRSIInterface
-Rcpp::NumericVector laguerreRSIInterface(SEXP vin, double gamma);
-RcppExport SEXP btutils_laguerreRSIInterface(SEXP vinSEXP, SEXP gammaSEXP) {
+Rcpp::NumericVector laguerreRSIInterface(SEXP vin, double gamma, int threads);
+RcppExport SEXP btutils_laguerreRSIInterface(SEXP vinSEXP, SEXP gammaSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type vin(vinSEXP);
+    Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(laguerreRSIInterface(vin, gamma, threads));
+    return __result;
+END_RCPP
+}
+// laguerreBatchInterface
+Rcpp::List laguerreBatchInterface(SEXP xIn, SEXP gammasIn, bool withFilter, bool withRSI, int threads);
+RcppExport SEXP btutils_laguerreBatchInterface(SEXP xInSEXP, SEXP gammasInSEXP, SEXP withFilterSEXP, SEXP withRSISEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type xIn(xInSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type gammasIn(gammasInSEXP);
+    Rcpp::traits::input_parameter< bool >::type withFilter(withFilterSEXP);
+    Rcpp::traits::input_parameter< bool >::type withRSI(withRSISEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(laguerreBatchInterface(xIn, gammasIn, withFilter, withRSI, threads));
+    return __result;
+END_RCPP
+}
+// laguerreFilterRSIInterface
+Rcpp::List laguerreFilterRSIInterface(SEXP vin, double gamma, int threads);
+RcppExport SEXP btutils_laguerreFilterRSIInterface(SEXP vinSEXP, SEXP gammaSEXP, SEXP threadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject __result;
     Rcpp::RNGScope __rngScope;
     Rcpp::traits::input_parameter< SEXP >::type vin(vinSEXP);
     Rcpp::traits::input_parameter< double >::type gamma(gammaSEXP);
-    __result = Rcpp::wrap(laguerreRSIInterface(vin, gamma));
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(laguerreFilterRSIInterface(vin, gamma, threads));
+    return __result;
+END_RCPP
+}
+// rollingWindowInterface
+Rcpp::NumericVector rollingWindowInterface(SEXP xIn, int n, int stat, int threads);
+RcppExport SEXP btutils_rollingWindowInterface(SEXP xInSEXP, SEXP nSEXP, SEXP statSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type xIn(xInSEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< int >::type stat(statSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(rollingWindowInterface(xIn, n, stat, threads));
+    return __result;
+END_RCPP
+}
+// returnsRSIInterface
+Rcpp::NumericVector returnsRSIInterface(SEXP xIn, int n, int threads);
+RcppExport SEXP btutils_returnsRSIInterface(SEXP xInSEXP, SEXP nSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject __result;
+    Rcpp::RNGScope __rngScope;
+    Rcpp::traits::input_parameter< SEXP >::type xIn(xInSEXP);
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    __result = Rcpp::wrap(returnsRSIInterface(xIn, n, threads));
     return __result;
 END_RCPP
 }
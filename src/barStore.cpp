@@ -0,0 +1,327 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <Rcpp.h>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "common.h"
+#include "barStore.h"
+
+using namespace Rcpp;
+
+namespace
+{
+   const char barStoreMagic[8] = { 'B', 'T', 'B', 'A', 'R', 'S', '\0', '\0' };
+}
+
+#ifdef _WIN32
+
+MappedFile::MappedFile() : data_(NULL), size_(0), file_(INVALID_HANDLE_VALUE), mapping_(NULL) {}
+
+bool MappedFile::open(const std::string & path)
+{
+   close();
+
+   file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   if(file_ == INVALID_HANDLE_VALUE) return false;
+
+   LARGE_INTEGER size;
+   if(!GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+      close();
+      return false;
+   }
+
+   mapping_ = CreateFileMappingA(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+   if(mapping_ == NULL) {
+      close();
+      return false;
+   }
+
+   data_ = static_cast<const char *>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+   if(data_ == NULL) {
+      close();
+      return false;
+   }
+
+   size_ = static_cast<std::size_t>(size.QuadPart);
+   return true;
+}
+
+void MappedFile::close()
+{
+   if(data_ != NULL) UnmapViewOfFile(data_);
+   if(mapping_ != NULL) CloseHandle(mapping_);
+   if(file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+
+   data_ = NULL;
+   size_ = 0;
+   mapping_ = NULL;
+   file_ = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+MappedFile::MappedFile() : data_(NULL), size_(0), fd_(-1) {}
+
+bool MappedFile::open(const std::string & path)
+{
+   close();
+
+   fd_ = ::open(path.c_str(), O_RDONLY);
+   if(fd_ < 0) return false;
+
+   struct stat st;
+   if(fstat(fd_, &st) != 0 || st.st_size == 0) {
+      close();
+      return false;
+   }
+
+   void * addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+   if(addr == MAP_FAILED) {
+      close();
+      return false;
+   }
+
+   data_ = static_cast<const char *>(addr);
+   size_ = st.st_size;
+   return true;
+}
+
+void MappedFile::close()
+{
+   if(data_ != NULL) munmap(const_cast<char *>(data_), size_);
+   if(fd_ >= 0) ::close(fd_);
+
+   data_ = NULL;
+   size_ = 0;
+   fd_ = -1;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+   close();
+}
+
+BarStore::BarStore(const std::string & path) :
+   bars_(0),
+   indexType_(BAR_INDEX_DATE),
+   generation_(0),
+   columns_(NULL)
+{
+   if(!file_.open(path)) Rcpp::stop("Can't map the bar file " + path);
+
+   if(file_.size() < sizeof(BarStoreHeader)) Rcpp::stop("Invalid bar file " + path);
+
+   BarStoreHeader header;
+   std::memcpy(&header, file_.data(), sizeof(header));
+
+   if(std::memcmp(header.magic, barStoreMagic, sizeof(barStoreMagic)) != 0 ||
+      header.version != BAR_STORE_VERSION ||
+      header.columns != BAR_COLUMN_COUNT ||
+      header.bars < 0 ||
+      header.bars > INT_MAX ||
+      file_.size() < sizeof(header) + static_cast<std::size_t>(header.bars)*BAR_COLUMN_COUNT*sizeof(double)) {
+      Rcpp::stop("Invalid bar file " + path);
+   }
+
+   bars_ = static_cast<int>(header.bars);
+   indexType_ = header.indexType;
+   generation_ = header.generation;
+
+   // The header is 64 bytes and the mapping is page aligned, thus, the columns
+   // are aligned for doubles
+   columns_ = reinterpret_cast<const double *>(file_.data() + sizeof(header));
+}
+
+DoubleView BarStore::column(BarColumn col) const
+{
+   return DoubleView(columns_ + static_cast<std::size_t>(col)*bars_, bars_);
+}
+
+void writeBarStore(
+         const std::string & path,
+         const DoubleView & index,
+         int indexType,
+         const double * columns,
+         int bars,
+         int generation)
+{
+   BarStoreHeader header;
+   std::memset(&header, 0, sizeof(header));
+   std::memcpy(header.magic, barStoreMagic, sizeof(barStoreMagic));
+   header.version = BAR_STORE_VERSION;
+   header.columns = BAR_COLUMN_COUNT;
+   header.bars = bars;
+   header.indexType = indexType;
+   header.generation = generation;
+
+   std::string tmp = path + ".tmp";
+   std::FILE * file = std::fopen(tmp.c_str(), "wb");
+   if(file == NULL) Rcpp::stop("Can't create the bar file " + tmp);
+
+   std::size_t values = static_cast<std::size_t>(bars)*(BAR_COLUMN_COUNT - 1);
+   bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+             (bars == 0 || std::fwrite(index.begin(), sizeof(double), bars, file) == static_cast<std::size_t>(bars)) &&
+             (bars == 0 || std::fwrite(columns, sizeof(double), values, file) == values);
+   ok = std::fclose(file) == 0 && ok;
+
+   if(!ok) {
+      std::remove(tmp.c_str());
+      Rcpp::stop("Can't write the bar file " + tmp);
+   }
+
+   // Replaces the file in a single step, the existing one is kept on failure
+#ifdef _WIN32
+   // rename doesn't replace an existing file on Windows. Fails while a reader
+   // has the file mapped.
+   bool replaced = MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+   bool replaced = std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+
+   if(!replaced) {
+      std::remove(tmp.c_str());
+      Rcpp::stop("Can't replace the bar file " + path + " (is it open?), the existing file is unchanged");
+   }
+}
+
+const BarStore * barStore(SEXP storeIn)
+{
+   if(TYPEOF(storeIn) != EXTPTRSXP || !Rf_inherits(storeIn, "bar.store")) Rcpp::stop("Not a bar store");
+
+   Rcpp::XPtr<BarStore> ptr(storeIn);
+   return ptr.get();
+}
+
+OhlcViews ohlcViews(SEXP ohlcIn)
+{
+   OhlcViews res;
+
+   if(TYPEOF(ohlcIn) == EXTPTRSXP) {
+      const BarStore * store = barStore(ohlcIn);
+      res.op = store->column(BAR_OPEN);
+      res.hi = store->column(BAR_HIGH);
+      res.lo = store->column(BAR_LOW);
+      res.cl = store->column(BAR_CLOSE);
+   } else {
+      // Only a double matrix is used in place - a coerced copy would be freed on
+      // return, leaving the views dangling. The R wrappers coerce (native.ohlc).
+      if(TYPEOF(ohlcIn) != REALSXP || !Rf_isMatrix(ohlcIn) || Rf_ncols(ohlcIn) < 4) {
+         Rcpp::stop("The ohlc must be a double matrix with at least four columns, or a bar store");
+      }
+
+      // The caller keeps the matrix alive (protected), the views remain valid
+      Rcpp::NumericMatrix ohlcMatrix(ohlcIn);
+      res.op = columnView(ohlcMatrix, 0);
+      res.hi = columnView(ohlcMatrix, 1);
+      res.lo = columnView(ohlcMatrix, 2);
+      res.cl = columnView(ohlcMatrix, 3);
+   }
+
+   return res;
+}
+
+// Writes the bars: index is a numeric vector, data a numeric matrix with the
+// open, high, low, close, volume and adjusted columns.
+// [[Rcpp::export("bar.store.write.interface")]]
+void barStoreWriteInterface(std::string path, SEXP indexIn, SEXP dataIn, int indexType, int generation)
+{
+   Rcpp::NumericVector index(indexIn);
+   Rcpp::NumericMatrix data(dataIn);
+
+   if(data.nrow() != index.size() || data.ncol() != BAR_COLUMN_COUNT - 1) {
+      Rcpp::stop("The bars must have an index and six columns of the same length");
+   }
+
+   writeBarStore(path, doubleView(index), indexType, data.begin(), index.size(), generation);
+}
+
+// [[Rcpp::export("bar.store.open.interface")]]
+SEXP barStoreOpenInterface(std::string path)
+{
+   Rcpp::XPtr<BarStore> ptr(new BarStore(path), true);
+   ptr.attr("class") = "bar.store";
+   return ptr;
+}
+
+// Copies the bars into R: a list with the index, its type and the data matrix
+// [[Rcpp::export("bar.store.read.interface")]]
+Rcpp::List barStoreReadInterface(SEXP storeIn)
+{
+   const BarStore * store = barStore(storeIn);
+   int bars = store->bars();
+
+   DoubleView index = store->column(BAR_INDEX);
+   Rcpp::NumericVector indexOut(index.begin(), index.end());
+
+   // The data columns are contiguous in the file and R matrices are column-major
+   DoubleView first = store->column(BAR_OPEN);
+   Rcpp::NumericMatrix data(bars, BAR_COLUMN_COUNT - 1);
+   std::copy(first.begin(), first.begin() + static_cast<std::size_t>(bars)*(BAR_COLUMN_COUNT - 1), data.begin());
+
+   return Rcpp::List::create(
+               Rcpp::Named("index") = indexOut,
+               Rcpp::Named("index.type") = store->indexType(),
+               Rcpp::Named("data") = data);
+}
+
+// [[Rcpp::export("bar.store.bars.interface")]]
+int barStoreBarsInterface(SEXP storeIn)
+{
+   return barStore(storeIn)->bars();
+}
+
+// [[Rcpp::export("bar.store.generation.interface")]]
+int barStoreGenerationInterface(SEXP storeIn)
+{
+   return barStore(storeIn)->generation();
+}
+
+// Only the index and its type, i.e. to convert the kernels' bar numbers to times
+// [[Rcpp::export("bar.store.index.interface")]]
+Rcpp::List barStoreIndexInterface(SEXP storeIn)
+{
+   const BarStore * store = barStore(storeIn);
+   DoubleView index = store->column(BAR_INDEX);
+
+   return Rcpp::List::create(
+               Rcpp::Named("index") = Rcpp::NumericVector(index.begin(), index.end()),
+               Rcpp::Named("index.type") = store->indexType());
+}
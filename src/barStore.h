@@ -0,0 +1,147 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef BAR_STORE_H_INCLUDED
+#define BAR_STORE_H_INCLUDED
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+#include "common.h"
+
+// A columnar bar file: a 64 byte header followed by the columns, each one a
+// contiguous array of doubles, in the order of the BarColumn values. The index
+// column holds the dates as days since the epoch (like R's Date), or the times
+// as seconds since the epoch (like R's POSIXct). The numbers are stored in the
+// native byte order of the writer.
+//
+// The file is memory mapped read-only, the kernels run on the columns in place.
+//
+// The generation is set by the writer, to tell apart files with the same bars
+// count and dates (i.e. YahooDb compares it with the generation of the stored
+// bars). The files written before it was added have a zero generation.
+
+#define BAR_STORE_VERSION 1
+
+enum BarColumn {
+   BAR_INDEX,
+   BAR_OPEN,
+   BAR_HIGH,
+   BAR_LOW,
+   BAR_CLOSE,
+   BAR_VOLUME,
+   BAR_ADJUSTED,
+   BAR_COLUMN_COUNT
+};
+
+enum BarIndexType {
+   BAR_INDEX_DATE,
+   BAR_INDEX_TIME
+};
+
+struct BarStoreHeader {
+   char magic[8];
+   int32_t version;
+   int32_t columns;
+   int64_t bars;
+   int32_t indexType;
+   int32_t generation;
+   int32_t reserved[8];
+};
+
+// A read-only memory mapping of a whole file
+class MappedFile {
+public:
+   MappedFile();
+   ~MappedFile();
+
+   // Returns false if the file can't be opened or mapped
+   bool open(const std::string & path);
+   void close();
+
+   const char * data() const { return data_; }
+   std::size_t size() const { return size_; }
+
+private:
+   // Not copyable
+   MappedFile(const MappedFile &);
+   MappedFile & operator=(const MappedFile &);
+
+   const char * data_;
+   std::size_t size_;
+#ifdef _WIN32
+   void * file_;           // HANDLE
+   void * mapping_;        // HANDLE
+#else
+   int fd_;
+#endif
+};
+
+class BarStore {
+public:
+   // Stops (an R error) if the file can't be mapped or isn't a valid bar file
+   explicit BarStore(const std::string & path);
+
+   int bars() const { return bars_; }
+   int indexType() const { return indexType_; }
+   int generation() const { return generation_; }
+   DoubleView column(BarColumn col) const;
+
+private:
+   MappedFile file_;
+   int bars_;
+   int indexType_;
+   int generation_;
+   const double * columns_;
+};
+
+// Writes a bar file. The columns after the index are given as a matrix, in the
+// order of BarColumn, with as many rows as the index. The file is written under
+// a temporary name and renamed, thus, readers never see a partial file.
+void writeBarStore(
+         const std::string & path,
+         const DoubleView & index,
+         int indexType,
+         const double * columns,
+         int bars,
+         int generation);
+
+// The store passed from R (an external pointer created by bar.store.open.interface)
+const BarStore * barStore(SEXP storeIn);
+
+// The open, high, low and close columns of an ohlc passed from R: either a
+// double matrix, or a bar store. No copies in both cases, anything else stops.
+struct OhlcViews {
+   DoubleView op;
+   DoubleView hi;
+   DoubleView lo;
+   DoubleView cl;
+};
+
+OhlcViews ohlcViews(SEXP ohlcIn);
+
+#endif // BAR_STORE_H_INCLUDED
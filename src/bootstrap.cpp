@@ -0,0 +1,152 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <Rcpp.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "common.h"
+#include "stats.h"
+#include "profiling.h"
+#include "random.h"
+
+// Resamples the returns (trade gains, or bar returns) and computes the final
+// equity, the max drawdown and the Sharpe ratio of each resample. With a block
+// length of 1 the returns are drawn independently (IID bootstrap). Otherwise,
+// the resample is built from blocks of consecutive returns, starting at random
+// positions and wrapping around the end (circular block bootstrap), which keeps
+// the serial dependence within a block.
+void bootstrapReturns(
+         const DoubleView & returns,
+         int samples,
+         int blockLength,
+         bool compound,
+         double scale,
+         uint64_t seed,
+         int threads,
+         std::vector<double> & finalEquity,
+         std::vector<double> & maxDrawdown,
+         std::vector<double> & sharpe)
+{
+   finalEquity.resize(samples);
+   maxDrawdown.resize(samples);
+   sharpe.resize(samples);
+
+   int len = returns.size();
+   if(len == 0) {
+      std::fill(finalEquity.begin(), finalEquity.end(), NA_REAL);
+      std::fill(maxDrawdown.begin(), maxDrawdown.end(), NA_REAL);
+      std::fill(sharpe.begin(), sharpe.end(), NA_REAL);
+      return;
+   }
+
+   if(blockLength < 1) blockLength = 1;
+   if(blockLength > len) blockLength = len;
+
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(static)
+   for(int ii = 0; ii < samples; ++ii) {
+      CounterRng rng(seed, ii);
+      EquityTracker equity(compound);
+      RunningStats stats;
+
+      int drawn = 0;
+      while(drawn < len) {
+         int jj = rng.index(len);
+         for(int kk = 0; kk < blockLength && drawn < len; ++kk, ++drawn) {
+            double ret = returns[jj];
+            equity.add(ret);
+            stats.add(ret);
+            if(++jj == len) jj = 0;
+         }
+      }
+
+      finalEquity[ii] = equity.equity();
+      maxDrawdown[ii] = equity.maxDrawdown();
+      sharpe[ii] = stats.sharpe(scale);
+   }
+}
+
+// The quantiles of a statistic over the resamples, written to out (a column of
+// the result matrix). The NAs (a Sharpe ratio with zero deviation) are ignored.
+static void resampleQuantiles(
+               std::vector<double> values,
+               const DoubleView & probs,
+               double * out)
+{
+   values.erase(std::remove_if(values.begin(), values.end(), isNA), values.end());
+   std::sort(values.begin(), values.end());
+   for(DoubleView::size_type ii = 0; ii < probs.size(); ++ii) {
+      out[ii] = sortedQuantile(values, probs[ii]);
+   }
+}
+
+// [[Rcpp::export("bootstrap.returns.interface")]]
+Rcpp::List bootstrapReturnsInterface(
+               SEXP returnsIn,
+               int samples,
+               int blockLength,
+               bool compound,
+               double scale,
+               SEXP probsIn,
+               double seed,
+               int threads)
+{
+   KernelProfile profile(PROFILE_BOOTSTRAP_RETURNS);
+
+   Rcpp::NumericVector returns(returnsIn);
+   Rcpp::NumericVector probs(probsIn);
+
+   if(samples < 1) Rcpp::stop("The number of samples must be positive");
+
+   std::vector<double> finalEquity;
+   std::vector<double> maxDrawdown;
+   std::vector<double> sharpe;
+
+   profile.compute();
+   bootstrapReturns(
+         doubleView(returns), samples, blockLength, compound, scale, static_cast<uint64_t>(seed), threads,
+         finalEquity, maxDrawdown, sharpe);
+   profile.convert();
+
+   // The resampled returns
+   profile.bars(static_cast<double>(samples)*returns.size());
+   profile.outputBytes(3*samples*sizeof(double));
+
+   // a row per probability, a column per statistic
+   int rows = probs.size();
+   Rcpp::NumericMatrix quantiles(rows, 3);
+   resampleQuantiles(finalEquity, doubleView(probs), quantiles.begin());
+   resampleQuantiles(maxDrawdown, doubleView(probs), quantiles.begin() + rows);
+   resampleQuantiles(sharpe, doubleView(probs), quantiles.begin() + 2*rows);
+
+   return Rcpp::List::create(
+               Rcpp::Named("quantiles") = quantiles,
+               Rcpp::Named("samples") = Rcpp::DataFrame::create(
+                     Rcpp::Named("FinalEquity") = finalEquity,
+                     Rcpp::Named("MaxDrawdown") = maxDrawdown,
+                     Rcpp::Named("Sharpe") = sharpe));
+}
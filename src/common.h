@@ -28,10 +28,19 @@
 #define COMMON_H_INCLUDED
 
 #include <Rcpp.h>
+#include <vector>
+#include <cstddef>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 // This needs to be changed if the c++ code is used outside R.
 // Is it better to use !R_finite() instead of R_IsNA()?
-inline bool isNA(double d) { return R_IsNA(d); }
+//
+// R_IsNA is a call into R, which inspects the NaN payload - the inlined NaN test
+// in front of it keeps the call off the common, non-missing, path.
+inline bool isNA(double d) { return ISNAN(d) && R_IsNA(d); }
 
 inline double roundAny(double d, double accuracy)
 {
@@ -48,8 +57,107 @@ inline double ceilAny(double d, double accuracy)
    return std::ceil(d/accuracy)*accuracy;
 }
 
+// The number of threads to use for a parallel loop. Non-positive values mean
+// all available. Without OpenMP everything runs on the calling thread.
+inline int threadCount(int threads)
+{
+#ifdef _OPENMP
+   return threads > 0 ? threads : omp_get_max_threads();
+#else
+   return 1;
+#endif
+}
+
+// The index of the calling thread within a parallel region, 0 outside one
+inline int threadIndex()
+{
+#ifdef _OPENMP
+   return omp_get_thread_num();
+#else
+   return 0;
+#endif
+}
+
 template <typename T> inline int sign(T t) {
    return (T(0) < t) - (t < T(0));
 }
 
+// A read-only view of contiguous storage, which doesn't own the data. The kernels
+// work on views, thus, they can run directly on the memory of an R vector, or of
+// a matrix column, without copying it into a std::vector first. The storage must
+// outlive the view.
+template <typename T>
+class ConstView {
+public:
+   typedef std::size_t size_type;
+
+   ConstView() : data_(NULL), size_(0) {}
+   ConstView(const T * data, size_type size) : data_(data), size_(size) {}
+   ConstView(const std::vector<T> & v) : data_(v.empty() ? NULL : &v[0]), size_(v.size()) {}
+
+   const T & operator[](size_type ii) const { return data_[ii]; }
+   size_type size() const { return size_; }
+   bool empty() const { return size_ == 0; }
+
+   const T * begin() const { return data_; }
+   const T * end() const { return data_ + size_; }
+
+private:
+   const T * data_;
+   size_type size_;
+};
+
+typedef ConstView<double> DoubleView;
+typedef ConstView<int> IntView;
+
+// The valid part of a series: the first and the last element which isn't NA
+// (both the length if all are NA), and whether there are NAs between them.
+// Found in a single scan, so that a kernel can pick a variant without the NA
+// checks when there are no gaps.
+struct NARange {
+   std::size_t first;
+   std::size_t last;
+   bool gaps;
+};
+
+inline NARange naRange(const DoubleView & v)
+{
+   NARange res;
+   std::size_t len = v.size();
+   res.first = 0;
+   while(res.first < len && isNA(v[res.first])) ++res.first;
+
+   res.last = len;
+   res.gaps = false;
+   if(res.first == len) return res;
+
+   res.last = len - 1;
+   while(isNA(v[res.last])) --res.last;
+
+   // A branch-free count of the NaNs, R_IsNA only if there are some
+   std::size_t nans = 0;
+   for(std::size_t ii = res.first; ii < res.last; ++ii) nans += ISNAN(v[ii]) ? 1 : 0;
+   for(std::size_t ii = res.first; nans > 0 && ii < res.last && !res.gaps; ++ii) res.gaps = isNA(v[ii]);
+
+   return res;
+}
+
+// Views over R storage. Constructing the Rcpp vector from a SEXP of the right
+// type doesn't copy, a SEXP of a different type is coerced (copied) by Rcpp.
+inline DoubleView doubleView(const Rcpp::NumericVector & v)
+{
+   return DoubleView(v.begin(), v.size());
+}
+
+inline IntView intView(const Rcpp::IntegerVector & v)
+{
+   return IntView(v.begin(), v.size());
+}
+
+// R matrices are stored column-major, thus, a column is contiguous
+inline DoubleView columnView(const Rcpp::NumericMatrix & m, int col)
+{
+   return DoubleView(m.begin() + static_cast<std::size_t>(col)*m.nrow(), m.nrow());
+}
+
 #endif // COMMON_H_INCLUDED
\ No newline at end of file
@@ -0,0 +1,60 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <Rcpp.h>
+
+#include "common.h"
+#include "compactIndicator.h"
+
+// A numeric (or integer, or logical) indicator to a compact one. The dimensions
+// of a matrix are kept.
+// [[Rcpp::export("compact.indicator.interface")]]
+Rcpp::RawVector compactIndicatorInterface(SEXP indicatorIn)
+{
+   Rcpp::NumericVector indicator(indicatorIn);
+   Rcpp::RawVector res(indicator.size());
+   IndicatorCode * codes = compactData(res);
+   for(int ii = 0; ii < indicator.size(); ++ii) {
+      codes[ii] = encodeIndicator(indicator[ii]);
+   }
+
+   if(Rf_isMatrix(indicatorIn)) res.attr("dim") = Rf_getAttrib(indicatorIn, R_DimSymbol);
+   return res;
+}
+
+// [[Rcpp::export("expand.indicator.interface")]]
+Rcpp::NumericVector expandIndicatorInterface(SEXP indicatorIn)
+{
+   Rcpp::RawVector indicator(indicatorIn);
+   CompactView codes = compactView(indicator);
+   Rcpp::NumericVector res(indicator.size());
+   for(CompactView::size_type ii = 0; ii < codes.size(); ++ii) {
+      res[ii] = decodeIndicator(codes[ii]);
+   }
+
+   if(Rf_isMatrix(indicatorIn)) res.attr("dim") = Rf_getAttrib(indicatorIn, R_DimSymbol);
+   return res;
+}
@@ -0,0 +1,108 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef COMPACT_INDICATOR_H_INCLUDED
+#define COMPACT_INDICATOR_H_INCLUDED
+
+#include <Rcpp.h>
+#include <cmath>
+
+#include "common.h"
+
+// A compact indicator keeps the position of a bar in a signed byte, instead of
+// a double - an eighth of the memory. The positions are integers in [-127, 127],
+// NA is -128. In R a compact indicator is a raw vector (a raw matrix for many
+// series), the bytes are reinterpreted as signed.
+typedef signed char IndicatorCode;
+const IndicatorCode INDICATOR_NA = -128;
+
+typedef ConstView<IndicatorCode> CompactView;
+
+// The kernels are templates on the indicator type, NA is specific to each
+inline bool isIndicatorNA(double d) { return isNA(d); }
+inline bool isIndicatorNA(IndicatorCode c) { return c == INDICATOR_NA; }
+
+// The sign of a position. The generic sign() maps the NA code to -1 - a short -
+// while a NaN double gets 0, this keeps both at 0.
+inline int sign(IndicatorCode c) { return c == INDICATOR_NA ? 0 : (c > 0) - (c < 0); }
+
+inline bool isCompactIndicator(SEXP x) { return TYPEOF(x) == RAWSXP; }
+
+inline IndicatorCode * compactData(Rcpp::RawVector & v)
+{
+   return reinterpret_cast<IndicatorCode *>(v.begin());
+}
+
+inline CompactView compactView(const Rcpp::RawVector & v)
+{
+   return CompactView(reinterpret_cast<const IndicatorCode *>(v.begin()), v.size());
+}
+
+// Stops for values which can't be represented. The range is checked before the
+// conversion - casting a NaN, or a value out of range, is undefined.
+inline IndicatorCode encodeIndicator(double d)
+{
+   if(isNA(d)) return INDICATOR_NA;
+   if(!(d >= -127.0 && d <= 127.0) || d != std::floor(d)) {
+      Rcpp::stop("A compact indicator holds integer positions in [-127, 127]");
+   }
+   return static_cast<IndicatorCode>(d);
+}
+
+inline double decodeIndicator(IndicatorCode c)
+{
+   return c == INDICATOR_NA ? NA_REAL : static_cast<double>(c);
+}
+
+// An indicator of either type, as passed from R
+class IndicatorView {
+public:
+   IndicatorView() : compact_(false) {}
+   explicit IndicatorView(const DoubleView & values) : compact_(false), values_(values) {}
+   explicit IndicatorView(const CompactView & codes) : compact_(true), codes_(codes) {}
+
+   bool compact() const { return compact_; }
+   const DoubleView & values() const { return values_; }
+   const CompactView & codes() const { return codes_; }
+   std::size_t size() const { return compact_ ? codes_.size() : values_.size(); }
+
+private:
+   bool compact_;
+   DoubleView values_;
+   CompactView codes_;
+};
+
+// A compact indicator is viewed in place. Any other is coerced to numeric, into
+// storage, which must outlive the view.
+inline IndicatorView indicatorView(SEXP x, Rcpp::NumericVector & storage)
+{
+   if(isCompactIndicator(x)) return IndicatorView(compactView(Rcpp::RawVector(x)));
+
+   storage = Rcpp::NumericVector(x);
+   return IndicatorView(doubleView(storage));
+}
+
+#endif // COMPACT_INDICATOR_H_INCLUDED
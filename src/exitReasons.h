@@ -0,0 +1,48 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef EXIT_REASONS_H_INCLUDED
+#define EXIT_REASONS_H_INCLUDED
+
+// The reasons a trade exits. Keep in sync with the constants in processTrades.R.
+#define EXIT_ON_LAST             0
+#define STOP_LIMIT_ON_OPEN       1
+#define STOP_LIMIT_ON_HIGH       2
+#define STOP_LIMIT_ON_LOW        3
+#define STOP_LIMIT_ON_CLOSE      4
+#define STOP_TRAILING_ON_OPEN    5
+#define STOP_TRAILING_ON_HIGH    6
+#define STOP_TRAILING_ON_LOW     7
+#define STOP_TRAILING_ON_CLOSE   8
+#define PROFIT_TARGET_ON_OPEN    9
+#define PROFIT_TARGET_ON_HIGH   10
+#define PROFIT_TARGET_ON_LOW    11
+#define PROFIT_TARGET_ON_CLOSE  12
+#define MAX_DAYS_LIMIT          13
+
+#define EXIT_REASON_COUNT       (MAX_DAYS_LIMIT + 1)
+
+#endif // EXIT_REASONS_H_INCLUDED
@@ -25,12 +25,23 @@
 //  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <Rcpp.h>
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
 #include "common.h"
+#include "compactIndicator.h"
+#include "indicatorRuns.h"
+#include "profiling.h"
 
 using namespace Rcpp;
 
+// The indicator is numeric, or compact (see compactIndicator.h), and is updated
+// in place
+template <typename T>
 void capTradeDuration(
-         std::vector<double> & indicator,
+         T * indicator,
+         std::size_t len,
          int shortMinCap,
          int longMinCap,
          int shortMaxCap,
@@ -39,20 +50,22 @@ void capTradeDuration(
 {
    if(shortMaxCap < 0 && longMaxCap < 0 && shortMinCap < 0 && longMinCap < 0) return;
 
-   std::vector<double>::size_type ii = 0;
+   std::size_t ii = 0;
 
    // Skip leading NAs
-   while(ii < indicator.size() && isNA(indicator[ii])) ++ii;
+   while(ii < len && isIndicatorNA(indicator[ii])) ++ii;
    
-   while(ii < indicator.size()) {
+   while(ii < len) {
       // Find the beginning of a position
-      while(ii < indicator.size() && indicator[ii] == 0) ++ii;
+      while(ii < len && indicator[ii] == 0) ++ii;
       
-      if(ii == indicator.size()) break;
+      if(ii == len) break;
       
       // Apply caps to this position
       int ss = sign(indicator[ii]);
-      int minCap, maxCap;
+
+      // No caps for NAs
+      int minCap = -1, maxCap = -1;
       if(ss == -1) {
          minCap = shortMinCap;
          maxCap = shortMaxCap;
@@ -65,7 +78,7 @@ void capTradeDuration(
          int daysIn = 1;
          bool done = false;
          int prevIndSign = -10;  // An impossible value if we are satisfying minCap
-         while(ii < indicator.size() && daysIn <= minCap) {
+         while(ii < len && daysIn <= minCap) {
             int indSign = sign(indicator[ii]);
 
             // Remember that the position changed, thus, we are done once minCap is satisfied
@@ -82,14 +95,14 @@ void capTradeDuration(
 
          if(done && waitNewSignal) {
             // We have satisfied minCap and we need to wait for a new signal
-            while(ii < indicator.size() && sign(indicator[ii]) == prevIndSign ) {
+            while(ii < len && sign(indicator[ii]) == prevIndSign ) {
                indicator[ii] = 0;
                ++ii;
             }
          }
 
          if(!done || !waitNewSignal) {
-            while(ii < indicator.size() && sign(indicator[ii]) == ss) {
+            while(ii < len && sign(indicator[ii]) == ss) {
                // Update the indicator if duration is over maxCap
                if(maxCap > -1 && daysIn > maxCap) indicator[ii] = 0;
                
@@ -98,13 +111,118 @@ void capTradeDuration(
             }
          }
       } else {
-         while(ii < indicator.size() && sign(indicator[ii]) == ss) ++ii;
+         while(ii < len && sign(indicator[ii]) == ss) ++ii;
+      }
+   }
+}
+
+// capTradeDuration on the runs of an indicator, in O(runs). The caps depend
+// only on the signs of the bars and on their count, thus, the input is read
+// and the output is written a span of bars at a time.
+void capTradeDurationRuns(
+         const RunView & runs,
+         int shortMinCap,
+         int longMinCap,
+         int shortMaxCap,
+         int longMaxCap,
+         bool waitNewSignal,
+         RunBuilder & out)
+{
+   RunCursor in(runs);
+
+   if(shortMaxCap < 0 && longMaxCap < 0 && shortMinCap < 0 && longMinCap < 0) {
+      while(!in.done()) in.moveRun(out, in.value());
+      return;
+   }
+
+   // Skip leading NAs
+   while(!in.done() && isNA(in.value())) in.moveRun(out, in.value());
+
+   while(!in.done()) {
+      // Find the beginning of a position
+      while(!in.done() && in.value() == 0) in.moveRun(out, 0.0);
+
+      if(in.done()) break;
+
+      // Apply caps to this position
+      int ss = sign(in.value());
+      int minCap = -1, maxCap = -1;
+      if(ss == -1) {
+         minCap = shortMinCap;
+         maxCap = shortMaxCap;
+      } else if(ss == 1) {
+         minCap = longMinCap;
+         maxCap = longMaxCap;
+      }
+
+      if(minCap != -1 || maxCap != -1) {
+         int daysIn = 1;
+         bool done = false;
+         int prevIndSign = -10;  // An impossible value if we are satisfying minCap
+         while(!in.done() && daysIn <= minCap) {
+            double value = in.value();
+            int indSign = sign(value);
+            if(!done && indSign != ss) done = true;
+            prevIndSign = indSign;
+
+            // The bars up to minCap are extended with the position
+            int count = in.take(std::min(in.left(), minCap - daysIn + 1));
+            out.append(indSign != ss ? ss : value, count);
+            daysIn += count;
+         }
+
+         if(done && waitNewSignal) {
+            // We have satisfied minCap and we need to wait for a new signal
+            while(!in.done() && sign(in.value()) == prevIndSign) in.moveRun(out, 0.0);
+         }
+
+         if(!done || !waitNewSignal) {
+            while(!in.done() && sign(in.value()) == ss) {
+               // The bars over maxCap are closed
+               double value = in.value();
+               int count = in.take(in.left());
+               int kept = maxCap > -1 ? std::max(0, std::min(count, maxCap - daysIn + 1)) : count;
+               out.append(value, kept);
+               out.append(0.0, count - kept);
+               daysIn += count;
+            }
+         }
+      } else {
+         while(!in.done() && sign(in.value()) == ss) in.moveRun(out, in.value());
       }
    }
 }
 
+// The runs (see rle) of the capped indicator
+// [[Rcpp::export("cap.trade.duration.runs.interface")]]
+Rcpp::List capTradeDurationRunsInterface(
+               SEXP lengthsIn,
+               SEXP valuesIn,
+               int shortMinCap,
+               int longMinCap,
+               int shortMaxCap,
+               int longMaxCap,
+               bool waitNewSignal)
+{
+   KernelProfile profile(PROFILE_CAP_TRADE_DURATION);
+
+   Rcpp::IntegerVector lengths(lengthsIn);
+   Rcpp::NumericVector values(valuesIn);
+   RunView runs = runView(lengths, values);
+
+   RunBuilder res;
+   profile.compute();
+   capTradeDurationRuns(runs, shortMinCap, longMinCap, shortMaxCap, longMaxCap, waitNewSignal, res);
+   profile.convert();
+   profile.bars(runs.size());
+   profile.outputBytes(res.size()*(sizeof(int) + sizeof(double)));
+
+   return res.rle();
+}
+
+// Returns an indicator of the same type, numeric or compact
 // [[Rcpp::export("cap.trade.duration.interface")]]
-Rcpp::NumericVector capTradeDurationInterface(
+SEXP capTradeDurationInterface(
                         SEXP indicatorIn,
                         int shortMinCap,
                         int longMinCap,
@@ -112,34 +230,60 @@ Rcpp::NumericVector capTradeDurationInterface(
                         int longMaxCap,
                         bool waitNewSignal)
 {
-   // Convert ohlc into std vectors
-   std::vector<double> indicator = Rcpp::as< std::vector<double> >(indicatorIn);
+   KernelProfile profile(PROFILE_CAP_TRADE_DURATION);
+
+   if(isCompactIndicator(indicatorIn)) {
+      Rcpp::RawVector input(indicatorIn);
+      Rcpp::RawVector indicator(input.begin(), input.end());
+      profile.compute();
+      capTradeDuration(
+            compactData(indicator),
+            indicator.size(),
+            shortMinCap,
+            longMinCap,
+            shortMaxCap,
+            longMaxCap,
+            waitNewSignal);
+      profile.convert();
+      profile.bars(indicator.size());
+      profile.outputBytes(indicator.size());
+      return indicator;
+   }
+
+   Rcpp::NumericVector input(indicatorIn);
+   Rcpp::NumericVector indicator(input.begin(), input.end());
+   profile.compute();
    capTradeDuration(
-         indicator,
+         indicator.begin(),
+         indicator.size(),
          shortMinCap,
          longMinCap,
          shortMaxCap,
          longMaxCap,
          waitNewSignal);
+   profile.convert();
+   profile.bars(indicator.size());
+   profile.outputBytes(indicator.size()*sizeof(double));
 
-   return Rcpp::NumericVector(indicator.begin(), indicator.end());
+   return indicator;
 }
 
+// The indicator (numeric or compact) has room for longEntries.size() elements
+template <typename T>
 void constructIndicator(
          const std::vector<bool> & longEntries,
          const std::vector<bool> & longExits,
          const std::vector<bool> & shortEntries,
          const std::vector<bool> & shortExits,
-         std::vector<double> & indicator)
+         T * indicator)
 {
-   indicator.resize(longEntries.size(), 0.0);
+   std::size_t len = longEntries.size();
+   std::size_t ii = 0;
 
-   std::vector<double>::size_type ii = 0;
-
-   while(ii < indicator.size() && !longEntries[ii] && !shortEntries[ii]) ++ii;
+   while(ii < len && !longEntries[ii] && !shortEntries[ii]) indicator[ii++] = 0;
 
    int pos = 0;
-   while(ii < indicator.size()) {
+   while(ii < len) {
       switch(pos) {
          case -1:
             if(longEntries[ii]) pos = 1;
@@ -161,38 +305,271 @@ void constructIndicator(
    }
 }
 
+// Returns a compact indicator if compact, a numeric otherwise
 // [[Rcpp::export("construct.indicator.interface")]]
-Rcpp::NumericVector constructIndicatorInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn)
+SEXP constructIndicatorInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn, bool compact)
 {
+   KernelProfile profile(PROFILE_CONSTRUCT_INDICATOR);
+
    std::vector<bool> longEntries = Rcpp::as<std::vector<bool> >(longEntriesIn);
    std::vector<bool> longExits  = Rcpp::as<std::vector<bool> >(longExitsIn);
    std::vector<bool> shortEntries = Rcpp::as<std::vector<bool> >(shortEntriesIn);
    std::vector<bool> shortExits  = Rcpp::as<std::vector<bool> >(shortExitsIn);
    
-   std::vector<double> indicator;
-   constructIndicator(longEntries, longExits, shortEntries, shortExits, indicator);
+   int len = longEntries.size();
+   profile.bars(len);
+   if(compact) {
+      Rcpp::RawVector indicator(len);
+      profile.compute();
+      constructIndicator(longEntries, longExits, shortEntries, shortExits, compactData(indicator));
+      profile.convert();
+      profile.outputBytes(4*len/8 + len);
+      return indicator;
+   }
+
+   Rcpp::NumericVector indicator(len);
+   profile.compute();
+   constructIndicator(longEntries, longExits, shortEntries, shortExits, indicator.begin());
+   profile.convert();
+   profile.outputBytes(4*len/8 + len*sizeof(double));
+   return indicator;
+}
+
+// The signals of a column packed into 64-bit words, bit jj of word ww is bar
+// 64*ww + jj. Logical NAs are true, as in construct.indicator.
+typedef uint64_t SignalWord;
+
+static const int SIGNAL_WORD_BITS = 64;
 
-   return Rcpp::NumericVector(indicator.begin(), indicator.end());
+static void packSignals(const int * signal, int len, SignalWord * words)
+{
+   for(int ii = 0; ii < len; ii += SIGNAL_WORD_BITS) {
+      int end = std::min(len, ii + SIGNAL_WORD_BITS);
+      SignalWord word = 0;
+      for(int jj = ii; jj < end; ++jj) {
+         word |= static_cast<SignalWord>(signal[jj] != 0) << (jj - ii);
+      }
+      words[ii / SIGNAL_WORD_BITS] = word;
+   }
+}
+
+// The index of the lowest set bit, the word must not be zero
+inline int lowestBit(SignalWord word)
+{
+#if defined(__GNUC__)
+   return __builtin_ctzll(word);
+#else
+   int res = 0;
+   while(!(word & 1)) {
+      word >>= 1;
+      ++res;
+   }
+   return res;
+#endif
 }
 
-void indicatorFromTrendline(const std::vector<double> & trendline, const std::vector<double> & thresholds, std::vector<int> & indicator)
+// The same state machine as constructIndicator, on packed signals. In each
+// position only two of the signals can change it (flat: the entries, long: the
+// short entries and the long exits, short: the long entries and the short exits),
+// and any of them does. Thus, the kernel jumps from one such signal to the next,
+// filling the bars in between with the current position, and a word without any
+// skips all of its bars at once. The output is an array (integer, or compact),
+// or runs.
+template <typename Output>
+void constructIndicatorPacked(
+         const SignalWord * longEntries,
+         const SignalWord * longExits,
+         const SignalWord * shortEntries,
+         const SignalWord * shortExits,
+         int len,
+         Output & indicator)
 {
-   indicator.resize(trendline.size(), 0);
+   int pos = 0;
+   for(int base = 0; base < len; base += SIGNAL_WORD_BITS) {
+      int ww = base / SIGNAL_WORD_BITS;
+      int end = std::min(len, base + SIGNAL_WORD_BITS);
+      int ii = base;
+      while(ii < end) {
+         SignalWord events;
+         if(pos == 0) events = longEntries[ww] | shortEntries[ww];
+         else if(pos == 1) events = shortEntries[ww] | longExits[ww];
+         else events = longEntries[ww] | shortExits[ww];
+
+         // Only the signals at, or after, the current bar
+         events &= ~static_cast<SignalWord>(0) << (ii - base);
+         if(events == 0) {
+            indicator.fill(ii, end, pos);
+            break;
+         }
+
+         // The padding bits of the last word are zero, thus, next < end
+         int next = base + lowestBit(events);
+         indicator.fill(ii, next, pos);
+
+         SignalWord bit = static_cast<SignalWord>(1) << (next - base);
+         switch(pos) {
+            case -1:
+               pos = (longEntries[ww] & bit) ? 1 : 0;
+               break;
+
+            case 0:
+               pos = (longEntries[ww] & bit) ? 1 : -1;
+               break;
+
+            case 1:
+               pos = (shortEntries[ww] & bit) ? -1 : 0;
+               break;
+         }
+
+         indicator.fill(next, next + 1, pos);
+         ii = next + 1;
+      }
+   }
+}
+
+// The signals are logical matrices (or vectors, a single column) of the same
+// dimensions, a column per series. Returns an integer matrix with the indicator
+// of each column, a raw matrix (compact indicators) if compact.
+// [[Rcpp::export("construct.indicators.interface")]]
+SEXP constructIndicatorsInterface(
+                        SEXP longEntriesIn,
+                        SEXP longExitsIn,
+                        SEXP shortEntriesIn,
+                        SEXP shortExitsIn,
+                        bool compact,
+                        int threads)
+{
+   KernelProfile profile(PROFILE_CONSTRUCT_INDICATORS);
+
+   // No copies for logical inputs
+   Rcpp::LogicalVector longEntries(longEntriesIn);
+   Rcpp::LogicalVector longExits(longExitsIn);
+   Rcpp::LogicalVector shortEntries(shortEntriesIn);
+   Rcpp::LogicalVector shortExits(shortExitsIn);
+
+   // A vector is a single column
+   int rows = Rf_nrows(longEntries);
+   int cols = Rf_ncols(longEntries);
+   SEXP others[3] = { longExits, shortEntries, shortExits };
+   for(int ii = 0; ii < 3; ++ii) {
+      if(Rf_nrows(others[ii]) != rows || Rf_ncols(others[ii]) != cols) {
+         Rcpp::stop("The signals must have the same dimensions");
+      }
+   }
+   R_xlen_t size = static_cast<R_xlen_t>(rows)*cols;
+
+   Rcpp::IntegerMatrix indicator;
+   Rcpp::RawMatrix codes;
+   if(compact) codes = Rcpp::RawMatrix(rows, cols);
+   else indicator = Rcpp::IntegerMatrix(rows, cols);
+
+   // The parallel region touches only raw pointers - no R, no allocations
+   const int * le = longEntries.begin();
+   const int * lx = longExits.begin();
+   const int * se = shortEntries.begin();
+   const int * sx = shortExits.begin();
+   IndicatorCode * codesData = compact ? compactData(codes) : NULL;
+   int * indicatorData = compact ? NULL : indicator.begin();
+
+   // A buffer per thread for the packed signals of a column
+   int words = (rows + SIGNAL_WORD_BITS - 1) / SIGNAL_WORD_BITS;
+   int threadsUsed = threadCount(threads);
+   std::size_t bufferSize = 4*static_cast<std::size_t>(words) + 1;
+   std::vector<SignalWord> packed(threadsUsed*bufferSize);
+
+   profile.compute();
+   #pragma omp parallel num_threads(threadsUsed)
+   {
+      SignalWord * ple = &packed[threadIndex()*bufferSize];
+      SignalWord * plx = ple + words;
+      SignalWord * pse = plx + words;
+      SignalWord * psx = pse + words;
+
+      #pragma omp for schedule(static)
+      for(int col = 0; col < cols; ++col) {
+         std::size_t offset = static_cast<std::size_t>(col)*rows;
+         packSignals(le + offset, rows, ple);
+         packSignals(lx + offset, rows, plx);
+         packSignals(se + offset, rows, pse);
+         packSignals(sx + offset, rows, psx);
+         if(compact) {
+            ArrayOutput<IndicatorCode> out(codesData + offset);
+            constructIndicatorPacked(ple, plx, pse, psx, rows, out);
+         } else {
+            ArrayOutput<int> out(indicatorData + offset);
+            constructIndicatorPacked(ple, plx, pse, psx, rows, out);
+         }
+      }
+   }
+   profile.convert();
+   profile.bars(static_cast<double>(size));
+   profile.outputBytes(static_cast<double>(size)*(compact ? 1 : sizeof(int)) + packed.size()*sizeof(SignalWord));
+
+   if(compact) return codes;
+   return indicator;
+}
+
+// construct.indicator producing the runs (see rle) of the indicator directly
+// [[Rcpp::export("construct.indicator.runs.interface")]]
+Rcpp::List constructIndicatorRunsInterface(SEXP longEntriesIn, SEXP longExitsIn, SEXP shortEntriesIn, SEXP shortExitsIn)
+{
+   KernelProfile profile(PROFILE_CONSTRUCT_INDICATOR);
+
+   Rcpp::LogicalVector longEntries(longEntriesIn);
+   Rcpp::LogicalVector longExits(longExitsIn);
+   Rcpp::LogicalVector shortEntries(shortEntriesIn);
+   Rcpp::LogicalVector shortExits(shortExitsIn);
+
+   int len = longEntries.size();
+   if(longExits.size() != len || shortEntries.size() != len || shortExits.size() != len) {
+      Rcpp::stop("The signals must have the same length");
+   }
+
+   int words = (len + SIGNAL_WORD_BITS - 1) / SIGNAL_WORD_BITS;
+   std::vector<SignalWord> packed(4*static_cast<std::size_t>(words) + 1);
+   SignalWord * le = &packed[0];
+   SignalWord * lx = le + words;
+   SignalWord * se = lx + words;
+   SignalWord * sx = se + words;
+
+   RunBuilder res;
+   profile.compute();
+   packSignals(longEntries.begin(), len, le);
+   packSignals(longExits.begin(), len, lx);
+   packSignals(shortEntries.begin(), len, se);
+   packSignals(shortExits.begin(), len, sx);
+   constructIndicatorPacked(le, lx, se, sx, len, res);
+   profile.convert();
+   profile.bars(len);
+   profile.outputBytes(packed.size()*sizeof(SignalWord) + res.size()*(sizeof(int) + sizeof(double)));
+
+   return res.rle();
+}
 
-   std::vector<double>::size_type ii = 0;
-   while(ii < trendline.size() && (isNA(trendline[ii]) || isNA(thresholds[ii]))) {
+// The output is an array, or runs (see indicatorRuns.h)
+template <typename Output>
+void indicatorFromTrendline(const std::vector<double> & trendline, const std::vector<double> & thresholds, Output & indicator)
+{
+   int len = trendline.size();
+   int ii = 0;
+   while(ii < len && (isNA(trendline[ii]) || isNA(thresholds[ii]))) {
       ++ii;
    }
 
    ++ii;
 
-   if(ii >= trendline.size()) return;
+   if(ii >= len) {
+      indicator.fill(0, len, 0);
+      return;
+   }
+
+   indicator.fill(0, ii, 0);
 
    int id = ii;
    int direction = sign(trendline[ii] - trendline[ii-1]);
    double threshold = trendline[ii] - thresholds[ii]*direction;
-   indicator[ii] = direction;
-   for(++ii; ii < trendline.size(); ++ii) {
+   indicator.fill(ii, ii + 1, direction);
+   for(++ii; ii < len; ++ii) {
       if(direction == -1) {
          if(trendline[ii] <= trendline[id]) {
             // A new minimum, reset
@@ -226,20 +603,46 @@ void indicatorFromTrendline(const std::vector<double> & trendline, const std::ve
             threshold = trendline[ii] + thresholds[ii];
          }
       }
-      indicator[ii] = direction;
+      indicator.fill(ii, ii + 1, direction);
    }
 }
 
 // [[Rcpp::export("indicator.from.trendline.interface")]]
 Rcpp::NumericVector indicatorFromTrendlineInterface(SEXP trendlineIn, SEXP thresholdsIn)
 {
+   KernelProfile profile(PROFILE_INDICATOR_FROM_TRENDLINE);
+
    std::vector<double> trendline = Rcpp::as<std::vector<double> >(trendlineIn);
    std::vector<double> thresholds  = Rcpp::as<std::vector<double> >(thresholdsIn);
    
-   std::vector<int> indicator;
-   indicatorFromTrendline(trendline, thresholds, indicator);
+   Rcpp::NumericVector indicator(trendline.size());
+   ArrayOutput<double> out(indicator.begin());
+   profile.compute();
+   indicatorFromTrendline(trendline, thresholds, out);
+   profile.convert();
+   profile.bars(trendline.size());
+   profile.outputBytes(3*trendline.size()*sizeof(double));
 
-   return Rcpp::NumericVector(indicator.begin(), indicator.end());
+   return indicator;
+}
+
+// indicator.from.trendline producing the runs (see rle) of the indicator
+// [[Rcpp::export("indicator.from.trendline.runs.interface")]]
+Rcpp::List indicatorFromTrendlineRunsInterface(SEXP trendlineIn, SEXP thresholdsIn)
+{
+   KernelProfile profile(PROFILE_INDICATOR_FROM_TRENDLINE);
+
+   std::vector<double> trendline = Rcpp::as<std::vector<double> >(trendlineIn);
+   std::vector<double> thresholds  = Rcpp::as<std::vector<double> >(thresholdsIn);
+
+   RunBuilder res;
+   profile.compute();
+   indicatorFromTrendline(trendline, thresholds, res);
+   profile.convert();
+   profile.bars(trendline.size());
+   profile.outputBytes(2*trendline.size()*sizeof(double) + res.size()*(sizeof(int) + sizeof(double)));
+
+   return res.rle();
 }
 
 void zigZag(
@@ -402,6 +805,8 @@ void zigZag(
 // [[Rcpp::export("zig.zag.interface")]]
 Rcpp::List zigZagInterface(SEXP pricesIn, SEXP changesIn, bool percent)
 {
+   KernelProfile profile(PROFILE_ZIG_ZAG);
+
    std::vector<double> prices = Rcpp::as<std::vector<double> >(pricesIn);
    std::vector<double> changes = Rcpp::as<std::vector<double> >(changesIn);
    
@@ -411,7 +816,11 @@ Rcpp::List zigZagInterface(SEXP pricesIn, SEXP changesIn, bool percent)
    std::vector<double> targets;
    std::vector<int> age;
    
+   profile.compute();
    zigZag(prices, changes, percent, indicator, inflections, targets, corrections, age);
+   profile.convert();
+   profile.bars(prices.size());
+   profile.outputBytes(prices.size()*(5*sizeof(double) + 2*sizeof(int)));
    
    return Rcpp::List::create(
                Rcpp::Named("indicator") = Rcpp::IntegerVector(indicator.begin(), indicator.end()),
@@ -419,4 +828,375 @@ Rcpp::List zigZagInterface(SEXP pricesIn, SEXP changesIn, bool percent)
                Rcpp::Named("targets") = Rcpp::NumericVector(targets.begin(), targets.end()),
                Rcpp::Named("corrections") = Rcpp::NumericVector(corrections.begin(), corrections.end()),
                Rcpp::Named("age") = Rcpp::IntegerVector(age.begin(), age.end()));
-}
\ No newline at end of file
+}
+
+// The outputs of zigZagMulti, a column per threshold (column-major, like an R
+// matrix). The outputs which are not needed are NULL and never computed.
+struct ZigZagOutputs {
+   int * indicator;
+   double * inflections;
+   double * targets;
+   double * corrections;
+   int * age;
+};
+
+// The number of thresholds (state machines) updated together in a pass
+static const int ZIG_ZAG_BLOCK = 16;
+
+// zigZag for a fixed threshold per state machine, thresholds [kbeg, kend), in a
+// single pass over close. The states of the machines are kept in parallel arrays
+// and updated bar by bar. The output of each bar is final once written - the
+// back-fill of zigZag only rewrites the values written already.
+static void zigZagMulti(
+               const DoubleView & close,
+               const DoubleView & changes,
+               bool percent,
+               int kbeg,
+               int kend,
+               const ZigZagOutputs & out)
+{
+   int len = close.size();
+   int count = kend - kbeg;
+   if(len == 0 || count <= 0) return;
+
+   std::vector<int> state(count, 0);             // 1 up, -1 down, 0 before the first trend
+   std::vector<double> extreme(count, close[0]); // the last extreme, or the first price
+   std::vector<double> inflection(count, NA_REAL);
+   std::vector<double> target(count, NA_REAL);
+   std::vector<int> age(count, 0);
+
+   for(int ii = 0; ii < len; ++ii) {
+      double price = close[ii];
+      for(int kk = 0; kk < count; ++kk) {
+         double change = 0.0;
+         if(ii == 0) {
+            // The first price is the reference of the first trend
+         } else if(state[kk] == 0) {
+            double up, down;
+            if(percent) {
+               up = price/extreme[kk] - 1.0;
+               down = 1.0 - price/extreme[kk];
+            } else {
+               up = price - extreme[kk];
+               down = extreme[kk] - price;
+            }
+
+            double threshold = changes[kbeg + kk];
+            if(up > threshold || down > threshold) {
+               state[kk] = up > threshold ? 1 : -1;
+               extreme[kk] = price;
+               inflection[kk] = price;
+               target[kk] = threshold;
+            }
+         } else if((state[kk] == 1 && price >= extreme[kk]) || (state[kk] == -1 && price <= extreme[kk])) {
+            // A new extreme
+            extreme[kk] = price;
+            target[kk] = changes[kbeg + kk];
+            ++age[kk];
+         } else {
+            if(percent) {
+               change = state[kk] == 1 ? 1.0 - price/extreme[kk] : price/extreme[kk] - 1.0;
+            } else {
+               change = state[kk] == 1 ? extreme[kk] - price : price - extreme[kk];
+            }
+
+            if(change > target[kk]) {
+               // Change in state
+               state[kk] = -state[kk];
+               extreme[kk] = price;
+               inflection[kk] = price;
+               target[kk] = changes[kbeg + kk];
+               age[kk] = 0;
+               change = 0.0;
+            } else {
+               ++age[kk];
+            }
+         }
+
+         std::size_t id = static_cast<std::size_t>(kbeg + kk)*len + ii;
+         if(out.indicator != NULL) out.indicator[id] = state[kk];
+         if(out.inflections != NULL) out.inflections[id] = inflection[kk];
+         if(out.targets != NULL) out.targets[id] = target[kk];
+         if(out.corrections != NULL) out.corrections[id] = change;
+         if(out.age != NULL) out.age[id] = age[kk];
+      }
+   }
+}
+
+// zig.zag for many (fixed) thresholds at once. Returns a list with a matrix,
+// a column per threshold, for each of the selected outputs, NULL for the rest.
+// [[Rcpp::export("zig.zag.multi.interface")]]
+Rcpp::List zigZagMultiInterface(
+               SEXP pricesIn,
+               SEXP changesIn,
+               bool percent,
+               bool withIndicator,
+               bool withInflections,
+               bool withTargets,
+               bool withCorrections,
+               bool withAge,
+               int threads)
+{
+   KernelProfile profile(PROFILE_ZIG_ZAG_MULTI);
+
+   Rcpp::NumericVector prices(pricesIn);
+   Rcpp::NumericVector changes(changesIn);
+
+   int len = prices.size();
+   int count = changes.size();
+
+   Rcpp::RObject indicator, inflections, targets, corrections, age;
+   ZigZagOutputs out = { NULL, NULL, NULL, NULL, NULL };
+   double outputBytes = 0.0;
+   if(withIndicator) {
+      Rcpp::IntegerMatrix mm(len, count);
+      out.indicator = mm.begin();
+      indicator = mm;
+      outputBytes += mm.size()*sizeof(int);
+   }
+   if(withInflections) {
+      Rcpp::NumericMatrix mm(len, count);
+      out.inflections = mm.begin();
+      inflections = mm;
+      outputBytes += mm.size()*sizeof(double);
+   }
+   if(withTargets) {
+      Rcpp::NumericMatrix mm(len, count);
+      out.targets = mm.begin();
+      targets = mm;
+      outputBytes += mm.size()*sizeof(double);
+   }
+   if(withCorrections) {
+      Rcpp::NumericMatrix mm(len, count);
+      out.corrections = mm.begin();
+      corrections = mm;
+      outputBytes += mm.size()*sizeof(double);
+   }
+   if(withAge) {
+      Rcpp::IntegerMatrix mm(len, count);
+      out.age = mm.begin();
+      age = mm;
+      outputBytes += mm.size()*sizeof(int);
+   }
+
+   DoubleView close = doubleView(prices);
+   DoubleView thresholds = doubleView(changes);
+   int blocks = (count + ZIG_ZAG_BLOCK - 1) / ZIG_ZAG_BLOCK;
+
+   profile.compute();
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(dynamic, 1)
+   for(int bb = 0; bb < blocks; ++bb) {
+      int kbeg = bb*ZIG_ZAG_BLOCK;
+      zigZagMulti(close, thresholds, percent, kbeg, std::min(count, kbeg + ZIG_ZAG_BLOCK), out);
+   }
+   profile.convert();
+   profile.bars(static_cast<double>(len)*count);
+   profile.outputBytes(outputBytes);
+
+   return Rcpp::List::create(
+               Rcpp::Named("indicator") = indicator,
+               Rcpp::Named("inflections") = inflections,
+               Rcpp::Named("targets") = targets,
+               Rcpp::Named("corrections") = corrections,
+               Rcpp::Named("age") = age);
+}
+
+// zigZag bar by bar - for live data. Each update consumes a price and a change
+// threshold and labels the bar exactly like zigZag labels it on the whole series.
+// The state is O(1): zigZag back-fills the bars between the last extreme and a
+// confirmed reversal, but with the trend they were labelled with already, thus,
+// the labels of the previous bars are final. The back-filled range is reported
+// as a relabel event - it confirms the labels of the completed swing, and the
+// extreme at its beginning as the swing's end.
+class ZigZagTracker {
+public:
+   ZigZagTracker(bool percent) :
+      percent_(percent),
+      bars_(0),
+      phase_(WAITING),
+      state_(0),
+      extreme_(NA_REAL),
+      extremeBar_(-1),
+      target_(NA_REAL),
+      indicator_(0),
+      inflection_(NA_REAL),
+      targetOut_(NA_REAL),
+      correction_(0.0),
+      age_(0),
+      relabelFrom_(-1),
+      relabelTo_(-1),
+      relabelValue_(0)
+   {}
+
+   // Processes the next bar, returns its indicator
+   int update(double price, double change)
+   {
+      int ii = bars_++;
+      relabelFrom_ = relabelTo_ = -1;
+      correction_ = 0.0;
+
+      if(phase_ == WAITING) {
+         // Skip all NAs in the changes
+         if(!isNA(change)) {
+            phase_ = SEARCHING;
+            setExtreme(price, ii, change);
+         }
+         return indicator_;
+      }
+
+      if(phase_ == SEARCHING) {
+         // Find the first up or down state
+         double up, down;
+         if(percent_) {
+            up = price/extreme_ - 1.0;
+            down = 1.0 - price/extreme_;
+         } else {
+            up = price - extreme_;
+            down = extreme_ - price;
+         }
+
+         if(up > target_ || down > target_) {
+            phase_ = TRENDING;
+            reverse(up > target_ ? 1 : -1, price, ii, change);
+         }
+         return indicator_;
+      }
+
+      if((state_ == 1 && price >= extreme_) || (state_ == -1 && price <= extreme_)) {
+         // A new extreme
+         setExtreme(price, ii, change);
+         targetOut_ = change;
+         ++age_;
+         return indicator_;
+      }
+
+      double cc;
+      if(percent_) {
+         cc = state_ == 1 ? 1.0 - price/extreme_ : price/extreme_ - 1.0;
+      } else {
+         cc = state_ == 1 ? extreme_ - price : price - extreme_;
+      }
+
+      if(cc > target_) {
+         // Change in state, the bars since the extreme stay in the old trend
+         if(extremeBar_ + 1 < ii) {
+            relabelFrom_ = extremeBar_ + 1;
+            relabelTo_ = ii - 1;
+            relabelValue_ = state_;
+         }
+         reverse(-state_, price, ii, change);
+      } else {
+         correction_ = cc;
+         ++age_;
+      }
+
+      return indicator_;
+   }
+
+   int bars() const { return bars_; }
+   int indicator() const { return indicator_; }
+   double inflection() const { return inflection_; }
+   double target() const { return targetOut_; }
+   double correction() const { return correction_; }
+   int age() const { return age_; }
+   int extremeBar() const { return extremeBar_; }
+   double extreme() const { return extreme_; }
+
+   // The range back-filled by the last update, from and to are -1 if none
+   int relabelFrom() const { return relabelFrom_; }
+   int relabelTo() const { return relabelTo_; }
+   int relabelValue() const { return relabelValue_; }
+
+private:
+   enum Phase { WAITING, SEARCHING, TRENDING };
+
+   void setExtreme(double price, int bar, double change)
+   {
+      extreme_ = price;
+      extremeBar_ = bar;
+      target_ = change;
+   }
+
+   void reverse(int state, double price, int bar, double change)
+   {
+      state_ = state;
+      setExtreme(price, bar, change);
+      indicator_ = state;
+      inflection_ = price;
+      targetOut_ = change;
+      age_ = 0;
+   }
+
+   bool percent_;
+   int bars_;
+   Phase phase_;
+   int state_;
+   double extreme_;
+   int extremeBar_;
+   double target_;
+
+   // The labels of the last bar
+   int indicator_;
+   double inflection_;
+   double targetOut_;
+   double correction_;
+   int age_;
+
+   int relabelFrom_;
+   int relabelTo_;
+   int relabelValue_;
+};
+
+// [[Rcpp::export("zig.zag.tracker.interface")]]
+SEXP zigZagTrackerInterface(bool percent)
+{
+   Rcpp::XPtr<ZigZagTracker> ptr(new ZigZagTracker(percent), true);
+   ptr.attr("class") = "zig.zag.tracker";
+   return ptr;
+}
+
+// The tracker passed from R (an external pointer created by zig.zag.tracker.interface)
+static ZigZagTracker * zigZagTracker(SEXP trackerIn)
+{
+   if(TYPEOF(trackerIn) != EXTPTRSXP || !Rf_inherits(trackerIn, "zig.zag.tracker")) Rcpp::stop("Not a zig-zag tracker");
+
+   Rcpp::XPtr<ZigZagTracker> ptr(trackerIn);
+   return ptr.get();
+}
+
+// Processes the prices in order, returns their indicators
+// [[Rcpp::export("zig.zag.update.interface")]]
+Rcpp::IntegerVector zigZagUpdateInterface(SEXP trackerIn, SEXP pricesIn, SEXP changesIn)
+{
+   ZigZagTracker * tracker = zigZagTracker(trackerIn);
+   Rcpp::NumericVector prices(pricesIn);
+   Rcpp::NumericVector changes(changesIn);
+   if(changes.size() != prices.size()) Rcpp::stop("The prices and the changes must have the same length");
+
+   Rcpp::IntegerVector indicator(prices.size());
+   for(int ii = 0; ii < prices.size(); ++ii) {
+      indicator[ii] = tracker->update(prices[ii], changes[ii]);
+   }
+   return indicator;
+}
+
+// [[Rcpp::export("zig.zag.state.interface")]]
+Rcpp::List zigZagStateInterface(SEXP trackerIn)
+{
+   const ZigZagTracker * tracker = zigZagTracker(trackerIn);
+
+   // The bars are numbered from 1, like in R
+   bool relabel = tracker->relabelFrom() >= 0;
+   return Rcpp::List::create(
+                        Rcpp::Named("bars") = tracker->bars(),
+                        Rcpp::Named("indicator") = tracker->indicator(),
+                        Rcpp::Named("inflection") = tracker->inflection(),
+                        Rcpp::Named("target") = tracker->target(),
+                        Rcpp::Named("correction") = tracker->correction(),
+                        Rcpp::Named("age") = tracker->age(),
+                        Rcpp::Named("extreme.bar") = tracker->extremeBar() >= 0 ? tracker->extremeBar() + 1 : NA_INTEGER,
+                        Rcpp::Named("extreme") = tracker->extreme(),
+                        Rcpp::Named("relabel.from") = relabel ? tracker->relabelFrom() + 1 : NA_INTEGER,
+                        Rcpp::Named("relabel.to") = relabel ? tracker->relabelTo() + 1 : NA_INTEGER,
+                        Rcpp::Named("relabel.value") = relabel ? tracker->relabelValue() : NA_INTEGER);
+}
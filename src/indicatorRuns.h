@@ -0,0 +1,145 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef INDICATOR_RUNS_H_INCLUDED
+#define INDICATOR_RUNS_H_INCLUDED
+
+#include <Rcpp.h>
+#include <vector>
+#include <algorithm>
+
+#include "common.h"
+
+// An indicator as runs of the same position, like R's rle: the length and the
+// value of each run. Indicators are long runs of the same position, thus, the
+// kernels on runs do work proportional to the number of runs, not of bars.
+struct RunView {
+   IntView lengths;
+   DoubleView values;
+
+   std::size_t size() const { return lengths.size(); }
+};
+
+// The kernels producing an indicator write it a span of bars at a time, to an
+// output which is either an array, or runs (RunBuilder).
+template <typename T>
+class ArrayOutput {
+public:
+   explicit ArrayOutput(T * data) : data_(data) {}
+
+   void fill(int from, int to, double value) { std::fill(data_ + from, data_ + to, static_cast<T>(value)); }
+
+private:
+   T * data_;
+};
+
+// Builds the runs of an indicator from consecutive spans, merging the adjacent
+// spans of the same value (NAs included).
+class RunBuilder {
+public:
+   void fill(int from, int to, double value) { append(value, to - from); }
+
+   void append(double value, int length)
+   {
+      if(length <= 0) return;
+      if(!values_.empty() && (isNA(value) ? isNA(values_.back()) : values_.back() == value)) {
+         lengths_.back() += length;
+      } else {
+         values_.push_back(value);
+         lengths_.push_back(length);
+      }
+   }
+
+   std::size_t size() const { return lengths_.size(); }
+
+   // An R rle object
+   Rcpp::List rle() const
+   {
+      Rcpp::List res = Rcpp::List::create(
+                           Rcpp::Named("lengths") = Rcpp::IntegerVector(lengths_.begin(), lengths_.end()),
+                           Rcpp::Named("values") = Rcpp::NumericVector(values_.begin(), values_.end()));
+      res.attr("class") = "rle";
+      return res;
+   }
+
+private:
+   std::vector<int> lengths_;
+   std::vector<double> values_;
+};
+
+// Reads runs a span of bars at a time. Empty runs are skipped.
+class RunCursor {
+public:
+   explicit RunCursor(const RunView & runs) : runs_(runs), kk_(0), left_(0) { load(); }
+
+   bool done() const { return kk_ >= runs_.size(); }
+   double value() const { return runs_.values[kk_]; }
+
+   // The bars left in the current run
+   int left() const { return left_; }
+
+   // Consumes count bars of the current run (at most left()), returns count
+   int take(int count)
+   {
+      left_ -= count;
+      if(left_ == 0) {
+         ++kk_;
+         load();
+      }
+      return count;
+   }
+
+   // Appends the rest of the current run to out, as value, and moves to the next
+   void moveRun(RunBuilder & out, double value)
+   {
+      out.append(value, left_);
+      take(left_);
+   }
+
+private:
+   void load()
+   {
+      while(kk_ < runs_.size() && runs_.lengths[kk_] <= 0) ++kk_;
+      if(kk_ < runs_.size()) left_ = runs_.lengths[kk_];
+   }
+
+   const RunView & runs_;
+   std::size_t kk_;
+   int left_;
+};
+
+// The runs of R's rle, lengths and values
+inline RunView runView(const Rcpp::IntegerVector & lengths, const Rcpp::NumericVector & values)
+{
+   if(lengths.size() != values.size()) Rcpp::stop("The lengths and the values of the runs differ in size");
+
+   RunView res;
+   res.lengths = intView(lengths);
+   res.values = doubleView(values);
+   return res;
+}
+
+#endif // INDICATOR_RUNS_H_INCLUDED
@@ -0,0 +1,80 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef LAGUERRE_H_INCLUDED
+#define LAGUERRE_H_INCLUDED
+
+#include <algorithm>
+
+// The state of the four-stage Laguerre cascade - only the previous value of
+// each stage is needed. The stages start one bar apart: l0 on the second bar,
+// l1 on the third, and so on, before that they are zero.
+struct LaguerreState {
+   double l0, l1, l2, l3;
+   int bars;
+
+   LaguerreState() : l0(0.0), l1(0.0), l2(0.0), l3(0.0), bars(0) {}
+
+   void update(double price, double gamma)
+   {
+      double n0 = 0.0, n1 = 0.0, n2 = 0.0, n3 = 0.0;
+      if(bars >= 1) n0 = (1.0 - gamma)*price + gamma*l0;
+      if(bars >= 2) n1 = -gamma*n0 + l0 + gamma*l1;
+      if(bars >= 3) n2 = -gamma*n1 + l1 + gamma*l2;
+      if(bars >= 4) n3 = -gamma*n2 + l2 + gamma*l3;
+      l0 = n0;
+      l1 = n1;
+      l2 = n2;
+      l3 = n3;
+      ++bars;
+   }
+};
+
+inline double laguerreFilterValue(double l0, double l1, double l2, double l3)
+{
+   return (l0 + 2.0*l1 + 2.0*l2 + l3) / 6.0;
+}
+
+// Zero when the stages are flat. Written with selects, instead of branches, so
+// that it vectorizes - the sums are the same, the terms which don't apply are 0.
+inline double laguerreRSIValue(double l0, double l1, double l2, double l3)
+{
+   double cu = std::max(l0 - l1, 0.0);
+   double cd = std::max(l1 - l0, 0.0);
+
+   cu += std::max(l1 - l2, 0.0);
+   cd += std::max(l2 - l1, 0.0);
+
+   cu += std::max(l2 - l3, 0.0);
+   cd += std::max(l3 - l2, 0.0);
+
+   // cu / total, or 0 if total is not positive (or NA)
+   double total = cu + cd;
+   double positive = total > 0.0 ? 1.0 : 0.0;
+   return std::max(0.0, positive * (cu / (total + (1.0 - positive))));
+}
+
+#endif // LAGUERRE_H_INCLUDED
@@ -27,49 +27,19 @@
 #include <vector>
 #include <cmath>
 #include <cassert>
+#include <algorithm>
 
 #include "common.h"
+#include "barStore.h"
+#include "compactIndicator.h"
+#include "exitReasons.h"
+#include "indicatorRuns.h"
+#include "profiling.h"
+#include "rangeIndex.h"
+#include "stats.h"
 
 using namespace Rcpp;
 
-#define EXIT_ON_LAST             0
-#define STOP_LIMIT_ON_OPEN       1
-#define STOP_LIMIT_ON_HIGH       2
-#define STOP_LIMIT_ON_LOW        3
-#define STOP_LIMIT_ON_CLOSE      4
-#define STOP_TRAILING_ON_OPEN    5
-#define STOP_TRAILING_ON_HIGH    6
-#define STOP_TRAILING_ON_LOW     7
-#define STOP_TRAILING_ON_CLOSE   8
-#define PROFIT_TARGET_ON_OPEN    9
-#define PROFIT_TARGET_ON_HIGH   10
-#define PROFIT_TARGET_ON_LOW    11
-#define PROFIT_TARGET_ON_CLOSE  12
-#define MAX_DAYS_LIMIT          13
-
-// #define DEBUG
-
-#ifdef DEBUG
-namespace
-{
-   char buf[4096];
-}
-
-void debugMessageFunc(const char * str)
-{
-   FILE * file = fopen("/home/ivannp/ttt/debug.txt", "a");
-   if(file != NULL)
-   {
-      fprintf(file, "%s\n", str);
-      fclose(file);
-   }
-}
-
-#define DEBUG_MSG(ss) debugMessageFunc((ss))
-#else
-#define DEBUG_MSG(ss)
-#endif
-
 struct TradeLocals {
    double entryPrice;
    double stopPrice;
@@ -94,6 +64,19 @@ struct TradeLocals {
    {}
 };
 
+// The stop order of a trade. A trailing stop takes precedence over a stop loss,
+// thus, a trade has at most one of them.
+enum StopType {
+   NO_STOP,
+   STOP_LOSS,
+   STOP_TRAILING
+};
+
+// The bar kernels are specialized at compile time on the stop type and on the
+// presence of a profit target. These never change during a trade, thus, the
+// per-bar code has no configuration branches. The flags in TradeLocals are
+// not used by the kernels.
+template <int Stop, bool HasProfitTarget>
 inline bool processShort(
    double op,
    double hi,
@@ -104,7 +87,7 @@ inline bool processShort(
    int & exitReason) {
 
    // Process the Open first
-   if(locals.hasStopTrailing) {
+   if(Stop == STOP_TRAILING) {
       if(op >= locals.stopPrice) {
          exitPrice = op;
          exitReason = STOP_TRAILING_ON_OPEN;
@@ -115,7 +98,7 @@ inline bool processShort(
 
          return true;
       } 
-   } else if(locals.hasStopLoss) {
+   } else if(Stop == STOP_LOSS) {
       if(op >= locals.stopPrice) {
          exitPrice = op;
          exitReason = STOP_LIMIT_ON_OPEN;
@@ -129,7 +112,7 @@ inline bool processShort(
    }
    
    // Profit target is checked after stop orders
-   if(locals.hasProfitTarget) {
+   if(HasProfitTarget) {
       if(op <= locals.targetPrice) {
          exitPrice = op;
          exitReason = PROFIT_TARGET_ON_OPEN;
@@ -143,14 +126,14 @@ inline bool processShort(
    }
    
    // The position is still on, update a trailing stop with the open
-   if(locals.hasStopTrailing && op <= locals.minPrice) {
+   if(Stop == STOP_TRAILING && op <= locals.minPrice) {
       locals.minPrice = op;
       locals.stopPrice =
          roundAny(locals.minPrice*(1.0 + std::abs(locals.stopTrailing)), locals.tickSize);
    }
 
    // Process the "internal" part of the bar
-   if(locals.hasStopTrailing) {
+   if(Stop == STOP_TRAILING) {
       // Check the high
       if(hi >= locals.stopPrice) {
          exitPrice = locals.stopPrice;
@@ -162,7 +145,7 @@ inline bool processShort(
          
          return true;
       }
-   } else if(locals.hasStopLoss) {
+   } else if(Stop == STOP_LOSS) {
       if(hi >= locals.stopPrice) {
          exitPrice = locals.stopPrice;
          exitReason = STOP_LIMIT_ON_HIGH;
@@ -176,7 +159,7 @@ inline bool processShort(
    }
    
    // Profit target is checked after stop orders
-   if(locals.hasProfitTarget) {
+   if(HasProfitTarget) {
       if(lo <= locals.targetPrice) {
          exitPrice = locals.targetPrice;
          exitReason = PROFIT_TARGET_ON_LOW;
@@ -190,7 +173,7 @@ inline bool processShort(
    }
    
    // The position is still on, update a trailing stop with the low
-   if(locals.hasStopTrailing && lo < locals.minPrice) {
+   if(Stop == STOP_TRAILING && lo < locals.minPrice) {
       locals.minPrice = lo;
       locals.stopPrice =
          roundAny(locals.minPrice*(1.0 + std::abs(locals.stopTrailing)), locals.tickSize);
@@ -201,14 +184,14 @@ inline bool processShort(
    locals.maxPrice = std::max(hi, locals.maxPrice);
    
    // Finally process the Close
-   if(locals.hasStopTrailing) {
+   if(Stop == STOP_TRAILING) {
       if(cl >= locals.stopPrice) {
          exitPrice = cl;
          exitReason = STOP_TRAILING_ON_CLOSE;
    
          return true;
       } 
-   } else if(locals.hasStopLoss) {
+   } else if(Stop == STOP_LOSS) {
       if(cl >= locals.stopPrice) {
          exitPrice = cl;
          exitReason = STOP_LIMIT_ON_CLOSE;
@@ -219,7 +202,7 @@ inline bool processShort(
    
    // Finally process the Close for a stop trailing order. The stop trailing might
    // have been updated by the Low, thus, we need one more check at the Close.
-   if(locals.hasProfitTarget) {
+   if(HasProfitTarget) {
       if(cl <= locals.targetPrice) {
          exitPrice = cl;
          exitReason = PROFIT_TARGET_ON_CLOSE;
@@ -231,6 +214,7 @@ inline bool processShort(
    return false;
 }
 
+template <int Stop, bool HasProfitTarget>
 inline bool processLong(
    double op,
    double hi,
@@ -241,7 +225,7 @@ inline bool processLong(
    int & exitReason) {
 
    // Process the Open first
-   if(locals.hasStopTrailing) {
+   if(Stop == STOP_TRAILING) {
       if(op <= locals.stopPrice) {
          exitPrice = op;
          exitReason = STOP_TRAILING_ON_OPEN;
@@ -252,7 +236,7 @@ inline bool processLong(
 
          return true;
       } 
-   } else if(locals.hasStopLoss) {
+   } else if(Stop == STOP_LOSS) {
       if(op <= locals.stopPrice) {
          exitPrice = op;
          exitReason = STOP_LIMIT_ON_OPEN;
@@ -266,7 +250,7 @@ inline bool processLong(
    }
    
    // Profit target is checked after stop orders
-   if(locals.hasProfitTarget) {
+   if(HasProfitTarget) {
       if(op >= locals.targetPrice) {
          exitPrice = op;
          exitReason = PROFIT_TARGET_ON_OPEN;
@@ -280,14 +264,14 @@ inline bool processLong(
    }
    
    // The position is still on, update a trailing stop with the Open
-   if(locals.hasStopTrailing && op > locals.maxPrice) {
+   if(Stop == STOP_TRAILING && op > locals.maxPrice) {
       locals.maxPrice = op;
       locals.stopPrice =
          roundAny(locals.maxPrice*(1.0 - std::abs(locals.stopTrailing)), locals.tickSize);
    }
 
    // Process the "internal" part of the bar
-   if(locals.hasStopTrailing) {
+   if(Stop == STOP_TRAILING) {
       // Check the high
       if(lo <= locals.stopPrice) {
          exitPrice = locals.stopPrice;
@@ -299,7 +283,7 @@ inline bool processLong(
          
          return true;
       }
-   } else if(locals.hasStopLoss) {
+   } else if(Stop == STOP_LOSS) {
       if(lo <= locals.stopPrice) {
          exitPrice = locals.stopPrice;
          exitReason = STOP_LIMIT_ON_LOW;
@@ -313,7 +297,7 @@ inline bool processLong(
    }
    
    // Profit target is checked after stop orders
-   if(locals.hasProfitTarget) {
+   if(HasProfitTarget) {
       if(hi >= locals.targetPrice) {
          exitPrice = locals.targetPrice;
          exitReason = PROFIT_TARGET_ON_HIGH;
@@ -327,7 +311,7 @@ inline bool processLong(
    }
    
    // The position is still on, update a trailing stop with the High
-   if(locals.hasStopTrailing && hi > locals.maxPrice) {
+   if(Stop == STOP_TRAILING && hi > locals.maxPrice) {
       locals.maxPrice = hi;
       locals.stopPrice =
          roundAny(locals.maxPrice*(1.0 - std::abs(locals.stopTrailing)), locals.tickSize);
@@ -339,7 +323,7 @@ inline bool processLong(
    
    // Finally process the Close for a stop trailing order. The stop trailing might
    // have been updated by the High, thus, we need one more check at the Close.
-   if(locals.hasStopTrailing) {
+   if(Stop == STOP_TRAILING) {
       if(cl <= locals.stopPrice) {
          exitPrice = cl;
          exitReason = STOP_TRAILING_ON_CLOSE;
@@ -351,39 +335,130 @@ inline bool processLong(
    return false;
 }
 
-// The actual workhorse used by the interface functions
-void processTrade(
-         const std::vector<double> & op,
-         const std::vector<double> & hi,
-         const std::vector<double> & lo,
-         const std::vector<double> & cl,
+// Processes the bars of a trade, starting at istart, until an exit is triggered.
+// Returns the index of the exit bar. The max days limit is folded into the last
+// bar to scan, thus, the loop tests only the bar exits.
+template <bool Long, int Stop, bool HasProfitTarget>
+int scanTrade(
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         int ibeg,
+         int iend,
+         int istart,
+         int maxDays,
+         TradeLocals & locals,
+         double & exitPrice,
+         int & exitReason)
+{
+   bool maxDaysExit = maxDays > 0 && maxDays <= iend - ibeg;
+   int ilast = maxDaysExit ? ibeg + maxDays : iend;
+   int ii;
+
+   for(ii = istart; ii <= ilast; ++ii) {
+      if(Long) {
+         if(processLong<Stop, HasProfitTarget>(op[ii], hi[ii], lo[ii], cl[ii], locals, exitPrice, exitReason)) return ii;
+      } else {
+         if(processShort<Stop, HasProfitTarget>(op[ii], hi[ii], lo[ii], cl[ii], locals, exitPrice, exitReason)) return ii;
+      }
+   }
+
+   if(maxDaysExit) {
+      // Maximum days for the trade reached
+      exitPrice = cl[ilast];
+      exitReason = MAX_DAYS_LIMIT;
+   } else {
+      exitPrice = cl[iend];
+      exitReason = EXIT_ON_LAST;
+   }
+
+   return ilast;
+}
+
+// Without a trailing stop, the exit levels are fixed for the whole trade. The
+// bars before the first one crossing a level only update the min and the max
+// price, thus, they can be skipped using the range index. Returns the first bar
+// to process. The last bar is always processed by the bar kernels, since it
+// may be a max days exit.
+template <bool Long>
+int skipBars(
+         const DoubleView & hi,
+         const DoubleView & lo,
          int ibeg,
          int iend,
+         int maxDays,
+         const RangeIndex * index,
+         TradeLocals & locals)
+{
+   if(index == NULL || !index->usable() || locals.hasStopTrailing) return ibeg + 1;
+
+   int ilast = iend;
+   if(maxDays > 0) ilast = std::min(iend, ibeg + maxDays);
+
+   double stopLevel = locals.hasStopLoss ? locals.stopPrice : (Long ? R_NegInf : R_PosInf);
+   double targetLevel = locals.hasProfitTarget ? locals.targetPrice : (Long ? R_PosInf : R_NegInf);
+
+   // A long trade is stopped by a low, a short trade by a high
+   if(Long) {
+      return index->firstCross(hi, lo, ibeg + 1, ilast - 1, stopLevel, targetLevel, locals.minPrice, locals.maxPrice);
+   }
+   return index->firstCross(hi, lo, ibeg + 1, ilast - 1, targetLevel, stopLevel, locals.minPrice, locals.maxPrice);
+}
+
+// Selects the specialization matching the trade's configuration - once per trade.
+template <bool Long>
+int dispatchTrade(
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         int ibeg,
+         int iend,
+         int maxDays,
+         const RangeIndex * index,
+         TradeLocals & locals,
+         double & exitPrice,
+         int & exitReason)
+{
+   int istart = skipBars<Long>(hi, lo, ibeg, iend, maxDays, index, locals);
+
+   if(locals.hasStopTrailing) {
+      if(locals.hasProfitTarget) {
+         return scanTrade<Long, STOP_TRAILING, true>(op, hi, lo, cl, ibeg, iend, istart, maxDays, locals, exitPrice, exitReason);
+      }
+      return scanTrade<Long, STOP_TRAILING, false>(op, hi, lo, cl, ibeg, iend, istart, maxDays, locals, exitPrice, exitReason);
+   } else if(locals.hasStopLoss) {
+      if(locals.hasProfitTarget) {
+         return scanTrade<Long, STOP_LOSS, true>(op, hi, lo, cl, ibeg, iend, istart, maxDays, locals, exitPrice, exitReason);
+      }
+      return scanTrade<Long, STOP_LOSS, false>(op, hi, lo, cl, ibeg, iend, istart, maxDays, locals, exitPrice, exitReason);
+   }
+
+   if(locals.hasProfitTarget) {
+      return scanTrade<Long, NO_STOP, true>(op, hi, lo, cl, ibeg, iend, istart, maxDays, locals, exitPrice, exitReason);
+   }
+   return scanTrade<Long, NO_STOP, false>(op, hi, lo, cl, ibeg, iend, istart, maxDays, locals, exitPrice, exitReason);
+}
+
+// Sets the stop and the target prices of a trade entered at entryPrice. Positions
+// are initiated only at the close, thus, the entry price is the close of the
+// entry bar.
+void initTradeLocals(
+         TradeLocals & locals,
+         double entryPrice,
          int pos,
          double stopLoss,
          double stopTrailing,
          double profitTarget,
-         int maxDays,
-         double tickSize,
-         int & exitIndex,
-         double & exitPrice,
-         int & exitReason,
-         double & gain,
-         double & minPrice,
-         double & maxPrice,
-         double & mae,  // maximum adverse excursion
-         double & mfe)  // maximum favorable excursion
+         double tickSize)
 {
-   int ii;
-   
-   TradeLocals locals;
    locals.hasStopLoss = false;
    locals.hasStopTrailing = false;
    locals.hasProfitTarget = false;
    locals.tickSize = tickSize;
 
-   // Currently positions are initiated only at the close
-   locals.minPrice = locals.maxPrice = locals.entryPrice = cl[ibeg];
+   locals.minPrice = locals.maxPrice = locals.entryPrice = entryPrice;
    
    if(pos < 0) {
       // Short position
@@ -402,33 +477,6 @@ void processTrade(
          locals.profitTarget = profitTarget;
          locals.hasProfitTarget = true;
       }
-      
-      for(ii = ibeg + 1; ii <= iend; ++ii) {
-         if(processShort(op[ii], hi[ii], lo[ii], cl[ii], locals, exitPrice, exitReason)) break;
-
-         // Maximum days for the trade reached
-         if(maxDays > 0 && (ii - ibeg) == maxDays) {
-            exitPrice = cl[ii];
-            exitReason = MAX_DAYS_LIMIT;
-            
-            break;
-         }
-      }
-      
-      if(ii > iend) {
-         exitPrice = cl[iend];
-         exitReason = EXIT_ON_LAST;
-         
-         ii = iend;
-      }
-
-      gain = 1.0 - exitPrice / locals.entryPrice;
-
-      mae = 1.0 - locals.maxPrice / locals.entryPrice;
-      mfe = 1.0 - locals.minPrice / locals.entryPrice;
-      
-      minPrice = locals.minPrice;
-      maxPrice = locals.maxPrice;
    } else {
       // Long position
       if(!isNA(stopTrailing)) {
@@ -446,36 +494,69 @@ void processTrade(
          locals.profitTarget = profitTarget;
          locals.targetPrice = roundAny(locals.entryPrice*(1.0 + std::abs(profitTarget)), tickSize);
       }
-      
-      for(ii = ibeg + 1; ii <= iend; ++ii) {
-         if(processLong(op[ii], hi[ii], lo[ii], cl[ii], locals, exitPrice, exitReason)) break;
-
-         // Maximum days for the trade reached
-         if(maxDays > 0 && (ii - ibeg) == maxDays) {
-            exitPrice = cl[ii];
-            exitReason = MAX_DAYS_LIMIT;
-            
-            break;
-         }
-      }
+   }
+}
 
-      if(ii > iend) {
-         exitPrice = cl[iend];
-         exitReason = EXIT_ON_LAST;
-         
-         ii = iend;
-      }
+// The gain, the maximum adverse excursion and the maximum favorable excursion
+// of a trade exited at exitPrice.
+void tradeGains(
+         const TradeLocals & locals,
+         int pos,
+         double exitPrice,
+         double & gain,
+         double & mae,
+         double & mfe)
+{
+   if(pos < 0) {
+      gain = 1.0 - exitPrice / locals.entryPrice;
 
+      mae = 1.0 - locals.maxPrice / locals.entryPrice;
+      mfe = 1.0 - locals.minPrice / locals.entryPrice;
+   } else {
       gain = exitPrice / locals.entryPrice - 1.0;
 
       mae = locals.minPrice / locals.entryPrice - 1.0;
       mfe = locals.maxPrice / locals.entryPrice - 1.0;
-      
-      minPrice = locals.minPrice;
-      maxPrice = locals.maxPrice;
    }
+}
+
+// The actual workhorse used by the interface functions
+void processTrade(
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         int ibeg,
+         int iend,
+         int pos,
+         double stopLoss,
+         double stopTrailing,
+         double profitTarget,
+         int maxDays,
+         double tickSize,
+         const RangeIndex * index,
+         int & exitIndex,
+         double & exitPrice,
+         int & exitReason,
+         double & gain,
+         double & minPrice,
+         double & maxPrice,
+         double & mae,  // maximum adverse excursion
+         double & mfe)  // maximum favorable excursion
+{
+   TradeLocals locals;
+   initTradeLocals(locals, cl[ibeg], pos, stopLoss, stopTrailing, profitTarget, tickSize);
+
+   if(pos < 0) {
+      exitIndex = dispatchTrade<false>(op, hi, lo, cl, ibeg, iend, maxDays, index, locals, exitPrice, exitReason);
+   } else {
+      exitIndex = dispatchTrade<true>(op, hi, lo, cl, ibeg, iend, maxDays, index, locals, exitPrice, exitReason);
+   }
+
+   tradeGains(locals, pos, exitPrice, gain, mae, mfe);
 
-   exitIndex = ii;
+   minPrice = locals.minPrice;
+   maxPrice = locals.maxPrice;
 }
 
 // [[Rcpp::export("process.trade.interface")]]
@@ -493,10 +574,18 @@ Rcpp::List processTradeInterface(
                int maxDays,
                double tickSize)
 {
-   std::vector<double> op = Rcpp::as< std::vector<double> >(opIn);
-   std::vector<double> hi = Rcpp::as< std::vector<double> >(hiIn);
-   std::vector<double> lo = Rcpp::as< std::vector<double> >(loIn);
-   std::vector<double> cl = Rcpp::as< std::vector<double> >(clIn);
+   KernelProfile profile(PROFILE_PROCESS_TRADE);
+
+   // No copies - the kernel runs on R's storage
+   Rcpp::NumericVector opVec(opIn);
+   Rcpp::NumericVector hiVec(hiIn);
+   Rcpp::NumericVector loVec(loIn);
+   Rcpp::NumericVector clVec(clIn);
+
+   DoubleView op = doubleView(opVec);
+   DoubleView hi = doubleView(hiVec);
+   DoubleView lo = doubleView(loVec);
+   DoubleView cl = doubleView(clVec);
 
    double exitPrice, minPrice, maxPrice;
    double gain, mae, mfe;
@@ -504,10 +593,13 @@ Rcpp::List processTradeInterface(
    int exitReason;
    
    // Call the actuall function to do the work. ibeg and iend are 0 based in cpp and 1 based in R.
+   profile.compute();
    processTrade(
       op, hi, lo, cl,
-      ibeg-1, iend-1, pos, stopLoss, stopTrailing, profitTarget, maxDays, tickSize,
+      ibeg-1, iend-1, pos, stopLoss, stopTrailing, profitTarget, maxDays, tickSize, NULL,
       exitIndex, exitPrice, exitReason, gain, minPrice, maxPrice, mae, mfe);
+   profile.convert();
+   profile.trade(exitIndex - (ibeg-1), exitReason);
    
    // Build and return the result
    return Rcpp::List::create(
@@ -521,19 +613,157 @@ Rcpp::List processTradeInterface(
                         Rcpp::Named("mfe") = mfe);
 }
 
+typedef bool (*BarProcessor)(double, double, double, double, TradeLocals &, double &, int &);
+
+// The bar kernel specialization matching a trade's configuration
+template <bool Long>
+BarProcessor selectBarProcessor(const TradeLocals & locals)
+{
+   if(locals.hasStopTrailing) {
+      if(locals.hasProfitTarget) return Long ? &processLong<STOP_TRAILING, true> : &processShort<STOP_TRAILING, true>;
+      return Long ? &processLong<STOP_TRAILING, false> : &processShort<STOP_TRAILING, false>;
+   } else if(locals.hasStopLoss) {
+      if(locals.hasProfitTarget) return Long ? &processLong<STOP_LOSS, true> : &processShort<STOP_LOSS, true>;
+      return Long ? &processLong<STOP_LOSS, false> : &processShort<STOP_LOSS, false>;
+   }
+
+   if(locals.hasProfitTarget) return Long ? &processLong<NO_STOP, true> : &processShort<NO_STOP, true>;
+   return Long ? &processLong<NO_STOP, false> : &processShort<NO_STOP, false>;
+}
+
+// Tracks a single open trade bar by bar - for live trading. Uses the same set up
+// and the same bar kernels as processTrade, thus, the exits are identical to
+// processing the same bars at once. Each bar is O(1) and doesn't allocate.
+class TradeTracker {
+public:
+   TradeTracker(
+         double entryPrice,
+         int pos,
+         double stopLoss,
+         double stopTrailing,
+         double profitTarget,
+         int maxDays,
+         double tickSize) :
+      pos_(pos),
+      maxDays_(maxDays),
+      bars_(0),
+      exited_(false),
+      exitPrice_(NA_REAL),
+      exitReason_(NA_INTEGER)
+   {
+      initTradeLocals(locals_, entryPrice, pos, stopLoss, stopTrailing, profitTarget, tickSize);
+      processor_ = pos < 0 ? selectBarProcessor<false>(locals_) : selectBarProcessor<true>(locals_);
+   }
+
+   // Processes the next bar. Returns true if the trade is closed, bars after the
+   // exit are ignored.
+   bool update(double op, double hi, double lo, double cl)
+   {
+      if(exited_) return true;
+
+      ++bars_;
+      if(processor_(op, hi, lo, cl, locals_, exitPrice_, exitReason_)) {
+         exited_ = true;
+      } else if(maxDays_ > 0 && bars_ == maxDays_) {
+         // Maximum days for the trade reached
+         exitPrice_ = cl;
+         exitReason_ = MAX_DAYS_LIMIT;
+         exited_ = true;
+      }
+
+      return exited_;
+   }
+
+   int position() const { return pos_; }
+   int bars() const { return bars_; }
+   bool exited() const { return exited_; }
+   double exitPrice() const { return exitPrice_; }
+   int exitReason() const { return exitReason_; }
+   const TradeLocals & locals() const { return locals_; }
+
+private:
+   TradeLocals locals_;
+   BarProcessor processor_;
+   int pos_;
+   int maxDays_;
+   int bars_;
+   bool exited_;
+   double exitPrice_;
+   int exitReason_;
+};
+
+// [[Rcpp::export("trade.tracker.interface")]]
+SEXP tradeTrackerInterface(
+         double entryPrice,
+         int pos,
+         double stopLoss,
+         double stopTrailing,
+         double profitTarget,
+         int maxDays,
+         double tickSize)
+{
+   Rcpp::XPtr<TradeTracker> ptr(
+         new TradeTracker(entryPrice, pos, stopLoss, stopTrailing, profitTarget, maxDays, tickSize),
+         true);
+   ptr.attr("class") = "trade.tracker";
+   return ptr;
+}
+
+// The tracker passed from R (an external pointer created by trade.tracker.interface)
+static TradeTracker * tradeTracker(SEXP trackerIn)
+{
+   if(TYPEOF(trackerIn) != EXTPTRSXP || !Rf_inherits(trackerIn, "trade.tracker")) Rcpp::stop("Not a trade tracker");
+
+   Rcpp::XPtr<TradeTracker> ptr(trackerIn);
+   return ptr.get();
+}
+
+// [[Rcpp::export("tracker.update.interface")]]
+bool trackerUpdateInterface(SEXP trackerIn, double op, double hi, double lo, double cl)
+{
+   TradeTracker * tracker = tradeTracker(trackerIn);
+   return tracker->update(op, hi, lo, cl);
+}
+
+// [[Rcpp::export("tracker.state.interface")]]
+Rcpp::List trackerStateInterface(SEXP trackerIn)
+{
+   const TradeTracker * tracker = tradeTracker(trackerIn);
+   const TradeLocals & locals = tracker->locals();
+
+   // The gain is NA until the exit, the excursions are up to date
+   double gain, mae, mfe;
+   tradeGains(locals, tracker->position(), tracker->exitPrice(), gain, mae, mfe);
+
+   return Rcpp::List::create(
+                        Rcpp::Named("exited") = tracker->exited(),
+                        Rcpp::Named("bars") = tracker->bars(),
+                        Rcpp::Named("exit.price") = tracker->exitPrice(),
+                        Rcpp::Named("exit.reason") = tracker->exitReason(),
+                        Rcpp::Named("stop.price") = (locals.hasStopLoss || locals.hasStopTrailing) ? locals.stopPrice : NA_REAL,
+                        Rcpp::Named("target.price") = locals.hasProfitTarget ? locals.targetPrice : NA_REAL,
+                        Rcpp::Named("gain") = gain,
+                        Rcpp::Named("min.price") = locals.minPrice,
+                        Rcpp::Named("max.price") = locals.maxPrice,
+                        Rcpp::Named("mae") = mae,
+                        Rcpp::Named("mfe") = mfe);
+}
+
 void processTrades(
-         const std::vector<double> & op,
-         const std::vector<double> & hi,
-         const std::vector<double> & lo,
-         const std::vector<double> & cl,
-         const std::vector<int> & ibeg,
-         const std::vector<int> & iend,
-         const std::vector<int> & position,
-         const std::vector<double> & stopLoss,
-         const std::vector<double> & stopTrailing,
-         const std::vector<double> & profitTarget,
-         const std::vector<int> & maxDays,
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         const IntView & ibeg,
+         const IntView & iend,
+         const IntView & position,
+         const DoubleView & stopLoss,
+         const DoubleView & stopTrailing,
+         const DoubleView & profitTarget,
+         const IntView & maxDays,
          double tickSize,
+         const RangeIndex * index,
+         int threads,
          std::vector<int> & iendOut,
          std::vector<double> & exitPriceOut,
          std::vector<double> & gainOut,
@@ -543,60 +773,43 @@ void processTrades(
          std::vector<double> & mfeOut,
          std::vector<int> & exitReasonOut )
 {
-   DEBUG_MSG("processTrades: entered");
-
-   // The number of rows in the output is known, reserve the space required.
-   iendOut.resize(0);
-   iendOut.reserve(ibeg.size());
-
-   exitPriceOut.resize(0);
-   exitPriceOut.reserve(ibeg.size());
-   
-   minPriceOut.resize(0);
-   minPriceOut.reserve(ibeg.size());
-   
-   maxPriceOut.resize(0);
-   maxPriceOut.reserve(ibeg.size());
-
-   gainOut.resize(0);
-   gainOut.reserve(ibeg.size());
-
-   maeOut.resize(0);
-   maeOut.reserve(ibeg.size());
-
-   mfeOut.resize(0);
-   mfeOut.reserve(ibeg.size());
-
-   exitReasonOut.resize(0);
-   exitReasonOut.reserve(ibeg.size());
-
-   for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii )
+   // The number of rows in the output is known. Each trade writes only its own
+   // row, thus, the result doesn't depend on the number of threads.
+   int count = ibeg.size();
+
+   iendOut.resize(count);
+   exitPriceOut.resize(count);
+   minPriceOut.resize(count);
+   maxPriceOut.resize(count);
+   gainOut.resize(count);
+   maeOut.resize(count);
+   mfeOut.resize(count);
+   exitReasonOut.resize(count);
+
+   // The trades vary in length, hence the dynamic schedule
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(dynamic, 64)
+   for(int ii = 0; ii < count; ++ii)
    {
-      double exitPrice, minPrice, maxPrice;
-      double gain;
-      double mae;
-      double mfe;
-      int exitIndex;
-      int exitReason;
-
       processTrade(
             op, hi, lo, cl,
-            ibeg[ii], iend[ii], position[ii], stopLoss[ii], stopTrailing[ii], profitTarget[ii], maxDays[ii], tickSize,
-            exitIndex, exitPrice, exitReason, gain, minPrice, maxPrice, mae, mfe);
-      // snprintf(buf, sizeof(buf), "%d: exitIndex = %d, exitPrice = %f, exitReason = %d, gain = %f, mae = %f, mfe = %f", 
-      //         ii, exitIndex, exitPrice, exitReason, gain, mae, mfe);
-      // DEBUG_MSG(buf);
+            ibeg[ii], iend[ii], position[ii], stopLoss[ii], stopTrailing[ii], profitTarget[ii], maxDays[ii], tickSize, index,
+            iendOut[ii], exitPriceOut[ii], exitReasonOut[ii], gainOut[ii],
+            minPriceOut[ii], maxPriceOut[ii], maeOut[ii], mfeOut[ii]);
+   }
+}
 
-      iendOut.push_back(exitIndex);
-      exitPriceOut.push_back(exitPrice);
-      minPriceOut.push_back(minPrice);
-      maxPriceOut.push_back(maxPrice);
-      gainOut.push_back(gain);
-      maeOut.push_back(mae);
-      mfeOut.push_back(mfe);
-      exitReasonOut.push_back(exitReason);
+// Adds the processed trades to a profile: the bars scanned by each trade and its
+// exit reason. The indexes are zero based. Also accounts for the output buffers.
+void profileTrades(KernelProfile & profile, const IntView & ibeg, const IntView & iendOut, const IntView & reason)
+{
+   if(!profile.enabled()) return;
+
+   for(IntView::size_type ii = 0; ii < ibeg.size(); ++ii) {
+      profile.trade(iendOut[ii] - ibeg[ii], reason[ii]);
    }
-   DEBUG_MSG("processTrades: exited");
+
+   // exit index and reason, exit price, gain, min/max price, mae and mfe
+   profile.outputBytes(ibeg.size()*(2*sizeof(int) + 6*sizeof(double)));
 }
 
 // [[Rcpp::export("process.trades.interface")]]
@@ -609,41 +822,32 @@ Rcpp::List processTradesInterface(
                      SEXP stopTrailingIn,
                      SEXP profitTargetIn,
                      SEXP maxDaysIn,
-                     double tickSize)
+                     double tickSize,
+                     SEXP indexIn,
+                     int threads)
 {
-   DEBUG_MSG("processTradesInterface: entered");
+   KernelProfile profile(PROFILE_PROCESS_TRADES);
+
    std::vector<int> ibeg = Rcpp::as< std::vector<int> >( ibegsIn );
    std::vector<int> iend = Rcpp::as< std::vector<int> >( iendsIn );
-   std::vector<int> position = Rcpp::as< std::vector<int> >( positionIn );
-   std::vector<double> stopLoss = Rcpp::as< std::vector<double> >( stopLossIn );
-   std::vector<double> stopTrailing = Rcpp::as< std::vector<double> >( stopTrailingIn );
-   std::vector<double> profitTarget = Rcpp::as< std::vector<double> >( profitTargetIn );
-   std::vector<int> maxDays  = Rcpp::as< std::vector<int> >( maxDaysIn );
-
-   // Convert ohlc into std vectors
-   Rcpp::NumericMatrix ohlcMatrix(ohlcIn);
-   std::vector<double> op;
-   std::vector<double> hi;
-   std::vector<double> lo;
-   std::vector<double> cl;
-   
-   int rows = ohlcMatrix.nrow();
-   
-   op.reserve(rows);
-   hi.reserve(rows);
-   lo.reserve(rows);
-   cl.reserve(rows);
-   
-   for(int ii = 0; ii < rows; ++ii)
-   {
-      op.push_back(ohlcMatrix(ii, 0));
-      hi.push_back(ohlcMatrix(ii, 1));
-      lo.push_back(ohlcMatrix(ii, 2));
-      cl.push_back(ohlcMatrix(ii, 3));
-
-   }
+   profile.outputBytes(2*ibeg.size()*sizeof(int));
+   Rcpp::IntegerVector position( positionIn );
+   Rcpp::NumericVector stopLoss( stopLossIn );
+   Rcpp::NumericVector stopTrailing( stopTrailingIn );
+   Rcpp::NumericVector profitTarget( profitTargetIn );
+   Rcpp::IntegerVector maxDays( maxDaysIn );
+
+   // The ohlc columns are used in place - R stores matrices column-major, and
+   // a bar store is mapped in memory
+   OhlcViews ohlc = ohlcViews(ohlcIn);
+   const DoubleView & op = ohlc.op;
+   const DoubleView & hi = ohlc.hi;
+   const DoubleView & lo = ohlc.lo;
+   const DoubleView & cl = ohlc.cl;
+
+   // An optional range index, built by range.index.interface on the same ohlc
+   const RangeIndex * index = rangeIndex(indexIn, op, hi, lo, cl);
    
-   assert(false);
    assert(ibeg.size() == iend.size());
 
    // vectors in c++ are zero based and in R are one based. convert
@@ -665,10 +869,14 @@ Rcpp::List processTradesInterface(
    std::vector<int> reason;
 
    // Call the c++ function doing the actual work
+   profile.compute();
    processTrades(
          op, hi, lo, cl,
-         ibeg, iend, position, stopLoss, stopTrailing, profitTarget, maxDays, tickSize,
+         ibeg, iend, intView(position), doubleView(stopLoss), doubleView(stopTrailing),
+         doubleView(profitTarget), intView(maxDays), tickSize, index, threads,
          iendOut, exitPrice, gain, minPrice, maxPrice, mae, mfe, reason);
+   profile.convert();
+   profileTrades(profile, ibeg, iendOut, reason);
 
    /* Just some values for testing
    for(int ii = 0; ii < ibeg.size(); ++ii )
@@ -693,7 +901,6 @@ Rcpp::List processTradesInterface(
    
    assert(ibeg.size() == iend.size());
    
-   DEBUG_MSG("processTradesInterface: exited");
    /*
    return Rcpp::List::create(
                Rcpp::Named("Entry") = Rcpp::IntegerVector(ibeg.begin(), ibeg.end()),
@@ -724,8 +931,209 @@ Rcpp::List processTradesInterface(
                Rcpp::Named("Reason") = reason);
 }
 
+// Summary of all trades for a single combination of parameters
+struct SweepSummary {
+   int trades;
+   int wins;
+   double gain;
+   double mae;
+   double mfe;
+   double bars;            // the bars scanned by all trades
+   int maxBars;            // the bars scanned by the longest trade
+   int reasons[EXIT_REASON_COUNT];
+
+   SweepSummary() :
+      trades(0),
+      wins(0),
+      gain(0.0),
+      mae(0.0),
+      mfe(0.0),
+      bars(0.0),
+      maxBars(0)
+   {
+      std::fill(reasons, reasons + EXIT_REASON_COUNT, 0);
+   }
+};
+
+// sweepTrades with the range index of the series, NULL for none
+static void sweepCombinations(
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         const IntView & ibeg,
+         const IntView & iend,
+         const IntView & position,
+         const DoubleView & stopLoss,
+         const DoubleView & stopTrailing,
+         const DoubleView & profitTarget,
+         const IntView & maxDays,
+         double tickSize,
+         const RangeIndex * index,
+         int threads,
+         std::vector<SweepSummary> & summaries)
+{
+   int combinations = stopLoss.size();
+   int trades = ibeg.size();
+
+   summaries.assign(combinations, SweepSummary());
+
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(dynamic, 1)
+   for(int ii = 0; ii < combinations; ++ii)
+   {
+      SweepSummary & summary = summaries[ii];
+
+      for(int jj = 0; jj < trades; ++jj)
+      {
+         double exitPrice, minPrice, maxPrice;
+         double gain, mae, mfe;
+         int exitIndex;
+         int exitReason;
+
+         processTrade(
+               op, hi, lo, cl,
+               ibeg[jj], iend[jj], position[jj], stopLoss[ii], stopTrailing[ii], profitTarget[ii], maxDays[ii], tickSize, index,
+               exitIndex, exitPrice, exitReason, gain, minPrice, maxPrice, mae, mfe);
+
+         ++summary.trades;
+         if(gain > 0.0) ++summary.wins;
+         summary.gain += gain;
+         summary.mae += mae;
+         summary.mfe += mfe;
+         summary.bars += exitIndex - ibeg[jj];
+         summary.maxBars = std::max(summary.maxBars, exitIndex - ibeg[jj]);
+         ++summary.reasons[exitReason];
+      }
+   }
+}
+
+// Runs the same trades with each combination of stop loss, trailing stop, profit
+// target and max days. The combinations (the grid) are given as parallel vectors.
+// The combinations are processed in parallel, the trades within a combination are
+// processed in order, thus, the sums don't depend on the number of threads.
+void sweepTrades(
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         const IntView & ibeg,
+         const IntView & iend,
+         const IntView & position,
+         const DoubleView & stopLoss,
+         const DoubleView & stopTrailing,
+         const DoubleView & profitTarget,
+         const IntView & maxDays,
+         double tickSize,
+         bool useIndex,
+         int threads,
+         std::vector<SweepSummary> & summaries)
+{
+   if(useIndex) {
+      // All combinations query the same series - build the range index once
+      RangeIndex index(op, hi, lo, cl);
+      sweepCombinations(op, hi, lo, cl, ibeg, iend, position, stopLoss, stopTrailing, profitTarget, maxDays, tickSize, &index, threads, summaries);
+   } else {
+      sweepCombinations(op, hi, lo, cl, ibeg, iend, position, stopLoss, stopTrailing, profitTarget, maxDays, tickSize, NULL, threads, summaries);
+   }
+}
+
+// [[Rcpp::export("sweep.trades.interface")]]
+Rcpp::List sweepTradesInterface(
+                     SEXP ohlcIn,
+                     SEXP ibegsIn,
+                     SEXP iendsIn,
+                     SEXP positionIn,
+                     SEXP stopLossIn,
+                     SEXP stopTrailingIn,
+                     SEXP profitTargetIn,
+                     SEXP maxDaysIn,
+                     double tickSize,
+                     bool useIndex,
+                     int threads)
+{
+   KernelProfile profile(PROFILE_SWEEP_TRADES);
+
+   std::vector<int> ibeg = Rcpp::as< std::vector<int> >( ibegsIn );
+   std::vector<int> iend = Rcpp::as< std::vector<int> >( iendsIn );
+   Rcpp::IntegerVector position( positionIn );
+
+   // The grid
+   Rcpp::NumericVector stopLoss( stopLossIn );
+   Rcpp::NumericVector stopTrailing( stopTrailingIn );
+   Rcpp::NumericVector profitTarget( profitTargetIn );
+   Rcpp::IntegerVector maxDays( maxDaysIn );
+
+   OhlcViews ohlc = ohlcViews(ohlcIn);
+
+   // c++ uses 0 based indexes
+   for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii)
+   {
+      ibeg[ii] -= 1;
+      iend[ii] -= 1;
+   }
+
+   std::vector<SweepSummary> summaries;
+   profile.compute();
+   sweepTrades(
+         ohlc.op, ohlc.hi, ohlc.lo, ohlc.cl,
+         ibeg, iend, intView(position),
+         doubleView(stopLoss), doubleView(stopTrailing), doubleView(profitTarget), intView(maxDays),
+         tickSize, useIndex, threads, summaries);
+   profile.convert();
+
+   int combinations = summaries.size();
+   Rcpp::IntegerVector trades(combinations);
+   Rcpp::NumericVector gain(combinations);
+   Rcpp::NumericVector winRate(combinations);
+   Rcpp::NumericVector mae(combinations);
+   Rcpp::NumericVector mfe(combinations);
+   Rcpp::IntegerMatrix reasons(combinations, EXIT_REASON_COUNT);
+
+   for(int ii = 0; ii < combinations; ++ii)
+   {
+      const SweepSummary & summary = summaries[ii];
+
+      trades[ii] = summary.trades;
+      gain[ii] = summary.gain;
+      if(summary.trades > 0) {
+         winRate[ii] = double(summary.wins) / summary.trades;
+         mae[ii] = summary.mae / summary.trades;
+         mfe[ii] = summary.mfe / summary.trades;
+      } else {
+         winRate[ii] = mae[ii] = mfe[ii] = NA_REAL;
+      }
+
+      for(int jj = 0; jj < EXIT_REASON_COUNT; ++jj) reasons(ii, jj) = summary.reasons[jj];
+
+      profile.trades(summary.trades, summary.bars, summary.maxBars, summary.reasons);
+   }
+   profile.outputBytes(2*ibeg.size()*sizeof(int) + combinations*sizeof(SweepSummary));
+
+   return Rcpp::List::create(
+               Rcpp::Named("summary") = Rcpp::DataFrame::create(
+                     Rcpp::Named("StopLoss") = stopLoss,
+                     Rcpp::Named("StopTrailing") = stopTrailing,
+                     Rcpp::Named("ProfitTarget") = profitTarget,
+                     Rcpp::Named("MaxDays") = maxDays,
+                     Rcpp::Named("Trades") = trades,
+                     Rcpp::Named("TotalGain") = gain,
+                     Rcpp::Named("WinRate") = winRate,
+                     Rcpp::Named("MeanMAE") = mae,
+                     Rcpp::Named("MeanMFE") = mfe),
+               Rcpp::Named("reasons") = reasons);
+}
+
+// The position of a bar, the interior NAs are flat - neither long nor short
+template <typename T>
+inline double indicatorPosition(T value)
+{
+   return isIndicatorNA(value) ? 0.0 : static_cast<double>(value);
+}
+
+// The indicator is numeric, or compact (see compactIndicator.h)
+template <typename T>
 void tradesFromIndicator(
-         const std::vector<double> & indicator,
+         const ConstView<T> & indicator,
          std::vector<int> & ibeg,
          std::vector<int> & iend,
          std::vector<int> & position)
@@ -735,35 +1143,38 @@ void tradesFromIndicator(
    
    int ii = 0;
    // Skipt starting NAs
-   while(ii < lastId && isNA(indicator[ii])) ++ii;
+   while(ii < lastId && isIndicatorNA(indicator[ii])) ++ii;
    
    if(ii < lastId) {
       // Process the first element
-      if(indicator[ii] != 0.0)
+      double previous = indicatorPosition(indicator[ii]);
+      if(previous != 0.0)
       {
          ibeg.push_back(ii);
-         position.push_back(indicator[ii]);
+         position.push_back(previous);
       }
       
       ++ii;
       
       for(; ii < lastId; ++ii)
       {
-         if(indicator[ii] != indicator[ii-1])
+         double current = indicatorPosition(indicator[ii]);
+         if(current != previous)
          {
-            if(indicator[ii-1] != 0.0)
+            if(previous != 0.0)
             {
                // Close the open position
                iend.push_back(ii);
             }
             
-            if(indicator[ii] != 0.0)
+            if(current != 0.0)
             {
                // Open a new position
                ibeg.push_back(ii);
-               position.push_back(indicator[ii]);
+               position.push_back(current);
             }
          }
+         previous = current;
       }
    }
 
@@ -776,14 +1187,112 @@ void tradesFromIndicator(
    assert(iend.size() == ibeg.size());
 }
 
+void tradesFromIndicator(
+         const IndicatorView & indicator,
+         std::vector<int> & ibeg,
+         std::vector<int> & iend,
+         std::vector<int> & position)
+{
+   if(indicator.compact()) tradesFromIndicator(indicator.codes(), ibeg, iend, position);
+   else tradesFromIndicator(indicator.values(), ibeg, iend, position);
+}
+
+// tradesFromIndicator on the runs of an indicator, in O(runs). The positions
+// change only at the beginnings of the runs.
+void tradesFromRuns(
+         const RunView & runs,
+         std::vector<int> & ibeg,
+         std::vector<int> & iend,
+         std::vector<int> & position)
+{
+   int len = 0;
+   for(std::size_t kk = 0; kk < runs.size(); ++kk) len += runs.lengths[kk];
+
+   // The last index needs special processing
+   int lastId = len - 1;
+
+   // Skip the starting NAs
+   std::size_t kk = 0;
+   int start = 0;
+   while(kk < runs.size() && start < lastId && isNA(runs.values[kk])) start += runs.lengths[kk++];
+
+   if(start < lastId) {
+      // Process the first run. As in tradesFromIndicator, the interior NAs are flat.
+      double previous = indicatorPosition(runs.values[kk]);
+      if(previous != 0.0) {
+         ibeg.push_back(start);
+         position.push_back(previous);
+      }
+
+      for(start += runs.lengths[kk++]; kk < runs.size() && start < lastId; start += runs.lengths[kk++]) {
+         double current = indicatorPosition(runs.values[kk]);
+         if(current != previous) {
+            if(previous != 0.0) {
+               // Close the open position
+               iend.push_back(start);
+            }
+
+            if(current != 0.0) {
+               // Open a new position
+               ibeg.push_back(start);
+               position.push_back(current);
+            }
+         }
+         previous = current;
+      }
+   }
+
+   // On the last index we only close an existing open position
+   if(ibeg.size() > iend.size()) {
+      iend.push_back(lastId);
+   }
+}
+
+// The trades from the runs (see rle) of an indicator
+// [[Rcpp::export("trades.from.runs.interface")]]
+Rcpp::List tradesFromRunsInterface(SEXP lengthsIn, SEXP valuesIn)
+{
+   KernelProfile profile(PROFILE_TRADES_FROM_INDICATOR);
+
+   Rcpp::IntegerVector lengths(lengthsIn);
+   Rcpp::NumericVector values(valuesIn);
+   RunView runs = runView(lengths, values);
+   std::vector<int> ibeg;
+   std::vector<int> iend;
+   std::vector<int> position;
+   profile.compute();
+   tradesFromRuns(runs, ibeg, iend, position);
+   profile.convert();
+   profile.bars(runs.size());
+   profile.outputBytes(3*ibeg.size()*sizeof(int));
+
+   // vectors in c++ are zero based and in R are one based.
+   for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii) {
+      ++ibeg[ii];
+      ++iend[ii];
+   }
+
+   return Rcpp::List::create(
+               Rcpp::Named("Entry") = Rcpp::IntegerVector(ibeg.begin(), ibeg.end()),
+               Rcpp::Named("Exit") = Rcpp::IntegerVector(iend.begin(), iend.end()),
+               Rcpp::Named("Position") = Rcpp::IntegerVector(position.begin(), position.end()));
+}
+
 // [[Rcpp::export("trades.from.indicator.interface")]]
 Rcpp::List tradesFromIndicatorInterface(SEXP indicatorIn)
 {
-   std::vector<double> indicator = Rcpp::as< std::vector<double> >( indicatorIn );
+   KernelProfile profile(PROFILE_TRADES_FROM_INDICATOR);
+
+   Rcpp::NumericVector storage;
+   IndicatorView indicator = indicatorView(indicatorIn, storage);
    std::vector<int> ibeg;
    std::vector<int> iend;
    std::vector<int> position;
+   profile.compute();
    tradesFromIndicator(indicator, ibeg, iend, position);
+   profile.convert();
+   profile.bars(indicator.size());
+   profile.outputBytes(3*ibeg.size()*sizeof(int));
    
    // vectors in c++ are zero based and in R are one based.
    // convert to the R format on the way out.
@@ -799,20 +1308,21 @@ Rcpp::List tradesFromIndicatorInterface(SEXP indicatorIn)
                Rcpp::Named("Position") = Rcpp::IntegerVector(position.begin(), position.end()));
 }
 
+// The returns are written to a buffer of cl.size() elements, initialized with
+// zeros by the caller (the bars outside the trades are not touched). Usually the
+// buffer is the storage of an R vector.
 void calculateReturns(
-         const std::vector<double> & cl,
-         const std::vector<int> & ibeg,
-         const std::vector<int> & iend,
-         const std::vector<int> & position,
-         const std::vector<double> & exitPrice,
+         const DoubleView & cl,
+         const IntView & ibeg,
+         const IntView & iend,
+         const IntView & position,
+         const DoubleView & exitPrice,
          bool inDollars,
-         std::vector<double> & returns)
+         double * returns)
 {
-   returns.resize(cl.size(), 0.0);
-
    if(!inDollars) {
       // Cycle through the trades
-      for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii) {
+      for(IntView::size_type ii = 0; ii < ibeg.size(); ++ii) {
          // Process the last bar of a trade separately - it needs special attention.
          for(int jj = ibeg[ii] + 1; jj < iend[ii]; ++jj) {
             returns[jj] = (cl[jj] / cl[jj-1] - 1.0)*position[ii];
@@ -823,7 +1333,7 @@ void calculateReturns(
       }
    } else {
       // Calculate the returns in dollars - useful for trading futures.
-      for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii) {
+      for(IntView::size_type ii = 0; ii < ibeg.size(); ++ii) {
          // Process the last bar of a trade separately - it needs special attention.
          for(int jj = ibeg[ii] + 1; jj < iend[ii]; ++jj) {
             returns[jj] = (cl[jj] - cl[jj-1])*position[ii];
@@ -844,12 +1354,15 @@ Rcpp::NumericVector calculateReturnsInterface(
                         SEXP exitPriceIn,
                         bool inDollars)
 {
-   // Convert inputs into std vectors
-   std::vector<double> cl = Rcpp::as< std::vector<double> >(clIn);
+   KernelProfile profile(PROFILE_CALCULATE_RETURNS);
+
+   // The prices and the trade columns are used in place. Only the indexes
+   // are copied, since they need to be converted.
+   Rcpp::NumericVector cl(clIn);
    std::vector<int> ibeg = Rcpp::as< std::vector<int> >(ibegIn);
    std::vector<int> iend = Rcpp::as< std::vector<int> >(iendIn);
-   std::vector<int> position = Rcpp::as< std::vector<int> >(positionIn);
-   std::vector<double> exitPrice = Rcpp::as< std::vector<double> >(exitPriceIn);
+   Rcpp::IntegerVector position(positionIn);
+   Rcpp::NumericVector exitPrice(exitPriceIn);
  
    // c++ uses 0 based indexes
    for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii)
@@ -858,8 +1371,408 @@ Rcpp::NumericVector calculateReturnsInterface(
       iend[ii] -= 1;
    }
    
-   std::vector<double> result;
-   calculateReturns(cl, ibeg, iend, position, exitPrice, inDollars, result);
+   Rcpp::NumericVector result(cl.size());
+   profile.compute();
+   calculateReturns(doubleView(cl), ibeg, iend, intView(position), doubleView(exitPrice), inDollars, result.begin());
+   profile.convert();
+   profile.bars(cl.size());
+   profile.outputBytes(2*ibeg.size()*sizeof(int) + cl.size()*sizeof(double));
+
+   return result;
+}
+
+// The performance statistics of a returns series (see calculateReturns)
+struct ReturnStats {
+   double cagr;
+   double volatility;
+   double sharpe;
+   double sortino;
+   double maxDrawdown;
+   int maxDrawdownDuration;
+   double exposure;
+};
+
+// The accumulation of returnStats over the returns in [first, last). Without
+// CheckNA the range must have no NAs.
+template <bool CheckNA>
+static void accumulateReturns(
+               const DoubleView & returns,
+               std::size_t first,
+               std::size_t last,
+               RunningStats & stats,
+               EquityTracker & equity,
+               double & downside,
+               int & active)
+{
+   for(std::size_t ii = first; ii < last; ++ii) {
+      double ret = returns[ii];
+      if(CheckNA && isNA(ret)) continue;
+
+      stats.add(ret);
+      equity.add(ret);
+      if(ret < 0.0) downside += ret*ret;
+      if(ret != 0.0) ++active;
+   }
+}
+
+// Computes all statistics in a single pass over the returns. The NAs (usually
+// the leading ones) are skipped. A zero return means out of the market.
+//
+// For percent returns the equity compounds and the CAGR is the annualized
+// growth of the equity, the max drawdown is a fraction of the peak. For returns
+// in dollars the equity is the sum of the returns, the CAGR is the average
+// yearly profit and the max drawdown is in dollars.
+//
+// The volatility, the Sharpe and the Sortino ratios are annualized using
+// periods (the number of bars per year), with a zero risk free rate. The
+// Sortino ratio uses the downside deviation of all returns below zero.
+void returnStats(
+         const DoubleView & returns,
+         double periods,
+         bool inDollars,
+         ReturnStats & res)
+{
+   RunningStats stats;
+   EquityTracker equity(!inDollars);
+   double downside = 0.0;
+   int active = 0;
+
+   // Only the valid range, without the NA checks unless it has gaps
+   NARange range = naRange(returns);
+   if(range.first < returns.size()) {
+      if(range.gaps) accumulateReturns<true>(returns, range.first, range.last + 1, stats, equity, downside, active);
+      else accumulateReturns<false>(returns, range.first, range.last + 1, stats, equity, downside, active);
+   }
+
+   int count = stats.count();
+   if(count == 0) {
+      res.cagr = res.volatility = res.sharpe = res.sortino = res.maxDrawdown = res.exposure = NA_REAL;
+      res.maxDrawdownDuration = NA_INTEGER;
+      return;
+   }
+
+   double years = count / periods;
+   if(inDollars) res.cagr = equity.equity() / years;
+   else res.cagr = equity.equity() > 0.0 ? std::pow(equity.equity(), 1.0/years) - 1.0 : -1.0;
+
+   res.volatility = count > 1 ? stats.sd()*std::sqrt(periods) : NA_REAL;
+   res.sharpe = stats.sharpe(periods);
+
+   double downsideDev = std::sqrt(downside / count);
+   res.sortino = downsideDev > 0.0 ? stats.mean() / downsideDev * std::sqrt(periods) : NA_REAL;
+
+   res.maxDrawdown = equity.maxDrawdown();
+   res.maxDrawdownDuration = equity.maxDrawdownDuration();
+   res.exposure = static_cast<double>(active) / count;
+}
+
+// The statistics of each column of a returns matrix (or of a single returns
+// vector), a row per column.
+// [[Rcpp::export("return.stats.interface")]]
+Rcpp::DataFrame returnStatsInterface(SEXP returnsIn, double periods, bool inDollars, int threads)
+{
+   KernelProfile profile(PROFILE_RETURN_STATS);
+
+   Rcpp::NumericVector returns(returnsIn);
+
+   int rows = returns.size();
+   int cols = 1;
+   if(Rf_isMatrix(returnsIn)) {
+      Rcpp::NumericMatrix matrix(returns);
+      rows = matrix.nrow();
+      cols = matrix.ncol();
+   }
+
+   std::vector<ReturnStats> stats(cols);
+
+   // The columns are independent
+   profile.compute();
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(dynamic)
+   for(int ii = 0; ii < cols; ++ii) {
+      DoubleView column(returns.begin() + static_cast<std::size_t>(ii)*rows, rows);
+      returnStats(column, periods, inDollars, stats[ii]);
+   }
+   profile.convert();
+   profile.bars(static_cast<double>(rows)*cols);
+   profile.outputBytes(cols*sizeof(ReturnStats));
+
+   Rcpp::NumericVector cagr(cols);
+   Rcpp::NumericVector volatility(cols);
+   Rcpp::NumericVector sharpe(cols);
+   Rcpp::NumericVector sortino(cols);
+   Rcpp::NumericVector maxDrawdown(cols);
+   Rcpp::IntegerVector maxDrawdownDuration(cols);
+   Rcpp::NumericVector exposure(cols);
+
+   for(int ii = 0; ii < cols; ++ii) {
+      cagr[ii] = stats[ii].cagr;
+      volatility[ii] = stats[ii].volatility;
+      sharpe[ii] = stats[ii].sharpe;
+      sortino[ii] = stats[ii].sortino;
+      maxDrawdown[ii] = stats[ii].maxDrawdown;
+      maxDrawdownDuration[ii] = stats[ii].maxDrawdownDuration;
+      exposure[ii] = stats[ii].exposure;
+   }
+
+   return Rcpp::DataFrame::create(
+               Rcpp::Named("CAGR") = cagr,
+               Rcpp::Named("Volatility") = volatility,
+               Rcpp::Named("Sharpe") = sharpe,
+               Rcpp::Named("Sortino") = sortino,
+               Rcpp::Named("MaxDrawdown") = maxDrawdown,
+               Rcpp::Named("MaxDrawdownDuration") = maxDrawdownDuration,
+               Rcpp::Named("Exposure") = exposure);
+}
+
+// The processed trades of an indicator, see tradeIndicator
+struct IndicatorTrades {
+   std::vector<int> ibeg;
+   std::vector<int> iend;
+   std::vector<int> position;
+   std::vector<int> iendOut;
+   std::vector<double> exitPrice;
+   std::vector<double> gain;
+   std::vector<double> minPrice;
+   std::vector<double> maxPrice;
+   std::vector<double> mae;
+   std::vector<double> mfe;
+   std::vector<int> reason;
+};
+
+// The trades from the indicator, processed with the same stop/target settings.
+// The indicator must be aligned with the ohlc. Optionally computes the returns
+// into a zero-filled buffer of cl.size() elements (NULL to skip them).
+void tradeIndicator(
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         const IndicatorView & indicator,
+         double stopLoss,
+         double stopTrailing,
+         double profitTarget,
+         int maxDays,
+         double tickSize,
+         const RangeIndex * index,
+         int threads,
+         bool inDollars,
+         double * returns,
+         IndicatorTrades & res)
+{
+   tradesFromIndicator(indicator, res.ibeg, res.iend, res.position);
+
+   // The same settings for all trades
+   std::vector<double> stopLosses(res.ibeg.size(), stopLoss);
+   std::vector<double> stopTrailings(res.ibeg.size(), stopTrailing);
+   std::vector<double> profitTargets(res.ibeg.size(), profitTarget);
+   std::vector<int> maxDayss(res.ibeg.size(), maxDays);
+
+   processTrades(
+         op, hi, lo, cl,
+         res.ibeg, res.iend, res.position, stopLosses, stopTrailings, profitTargets, maxDayss, tickSize, index, threads,
+         res.iendOut, res.exitPrice, res.gain, res.minPrice, res.maxPrice, res.mae, res.mfe, res.reason);
+
+   if(returns != NULL) {
+      calculateReturns(cl, res.ibeg, res.iendOut, res.position, res.exitPrice, inDollars, returns);
+   }
+}
+
+// The whole trade.indicator pipeline in a single call: the trades from the
+// indicator, processing the trades with the same stop/target settings, and
+// optionally the returns. The indicator must be aligned with the ohlc. Returns
+// a list with the processed trades and the returns (NULL if not requested).
+// [[Rcpp::export("trade.indicator.interface")]]
+Rcpp::List tradeIndicatorInterface(
+                     SEXP ohlcIn,
+                     SEXP indicatorIn,
+                     double stopLoss,
+                     double stopTrailing,
+                     double profitTarget,
+                     int maxDays,
+                     double tickSize,
+                     bool withReturns,
+                     bool inDollars,
+                     SEXP indexIn,
+                     int threads)
+{
+   KernelProfile profile(PROFILE_TRADE_INDICATOR);
+
+   OhlcViews ohlc = ohlcViews(ohlcIn);
+
+   Rcpp::NumericVector storage;
+   IndicatorView indicator = indicatorView(indicatorIn, storage);
+   if(indicator.size() != ohlc.cl.size()) Rcpp::stop("The indicator and the ohlc differ in length");
+
+   const RangeIndex * index = rangeIndex(indexIn, ohlc.op, ohlc.hi, ohlc.lo, ohlc.cl);
+
+   Rcpp::RObject returns;
+   double * returnsBuffer = NULL;
+   if(withReturns) {
+      Rcpp::NumericVector result(ohlc.cl.size());
+      returnsBuffer = result.begin();
+      returns = result;
+      profile.outputBytes(ohlc.cl.size()*sizeof(double));
+   }
+
+   IndicatorTrades res;
+   profile.compute();
+   tradeIndicator(
+         ohlc.op, ohlc.hi, ohlc.lo, ohlc.cl, indicator,
+         stopLoss, stopTrailing, profitTarget, maxDays, tickSize, index, threads,
+         inDollars, returnsBuffer, res);
+   profile.convert();
+   profileTrades(profile, res.ibeg, res.iendOut, res.reason);
+   profile.outputBytes(res.ibeg.size()*(3*sizeof(int) + 3*sizeof(double)));
+
+   // vectors in c++ are zero based and in R are one based.
+   // convert to the R format on the way out.
+   for(std::vector<int>::size_type ii = 0; ii < res.ibeg.size(); ++ii )
+   {
+      res.ibeg[ii] += 1;
+      res.iendOut[ii] += 1;
+   }
+
+   int count = res.ibeg.size();
+   return Rcpp::List::create(
+               Rcpp::Named("trades") = Rcpp::DataFrame::create(
+                     Rcpp::Named("Entry") = res.ibeg,
+                     Rcpp::Named("Exit") = res.iendOut,
+                     Rcpp::Named("Position") = res.position,
+                     Rcpp::Named("StopLoss") = std::vector<double>(count, stopLoss),
+                     Rcpp::Named("StopTrailing") = std::vector<double>(count, stopTrailing),
+                     Rcpp::Named("ProfitTarget") = std::vector<double>(count, profitTarget),
+                     Rcpp::Named("ExitPrice") = res.exitPrice,
+                     Rcpp::Named("Gain") = res.gain,
+                     Rcpp::Named("MinPrice") = res.minPrice,
+                     Rcpp::Named("MaxPrice") = res.maxPrice,
+                     Rcpp::Named("MAE") = res.mae,
+                     Rcpp::Named("MFE") = res.mfe,
+                     Rcpp::Named("Reason") = res.reason),
+               Rcpp::Named("returns") = returns);
+}
+
+// trade.indicator for many series at once: a list of ohlcs (matrices or bar
+// stores) and a list of indicators, each aligned with its ohlc. The series are
+// processed in parallel, each one on a single thread. The R objects are
+// accessed only outside the parallel loop - the workers see views and the
+// storage of the preallocated returns.
+//
+// Returns a list with the trades of all series in a single data frame, with a
+// Series column (the one based position in the list), and a list with the
+// returns of each series (NULL if not requested).
+// [[Rcpp::export("trade.indicators.interface")]]
+Rcpp::List tradeIndicatorsInterface(
+                     SEXP ohlcsIn,
+                     SEXP indicatorsIn,
+                     double stopLoss,
+                     double stopTrailing,
+                     double profitTarget,
+                     int maxDays,
+                     double tickSize,
+                     bool withReturns,
+                     bool inDollars,
+                     int threads)
+{
+   KernelProfile profile(PROFILE_TRADE_INDICATORS);
+
+   Rcpp::List ohlcs(ohlcsIn);
+   Rcpp::List indicators(indicatorsIn);
+
+   int series = ohlcs.size();
+   if(indicators.size() != series) Rcpp::stop("The number of indicators and ohlcs differ");
+
+   std::vector<OhlcViews> views(series);
+   std::vector<Rcpp::NumericVector> indicatorVectors(series);
+   std::vector<IndicatorView> indicatorViews(series);
+   std::vector<double *> returnsBuffers(series, static_cast<double *>(NULL));
+   Rcpp::List returns(withReturns ? series : 0);
+
+   for(int ii = 0; ii < series; ++ii) {
+      views[ii] = ohlcViews(ohlcs[ii]);
+
+      // A coerced indicator is a new object, kept alive until the end
+      indicatorViews[ii] = indicatorView(indicators[ii], indicatorVectors[ii]);
+      if(indicatorViews[ii].size() != views[ii].cl.size()) {
+         Rcpp::stop("The indicator and the ohlc differ in length");
+      }
+
+      if(withReturns) {
+         Rcpp::NumericVector result(views[ii].cl.size());
+         returnsBuffers[ii] = result.begin();
+         returns[ii] = result;
+         profile.outputBytes(views[ii].cl.size()*sizeof(double));
+      }
+   }
+
+   std::vector<IndicatorTrades> results(series);
+
+   profile.compute();
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(dynamic, 1)
+   for(int ii = 0; ii < series; ++ii) {
+      const OhlcViews & ohlc = views[ii];
+      tradeIndicator(
+            ohlc.op, ohlc.hi, ohlc.lo, ohlc.cl, indicatorViews[ii],
+            stopLoss, stopTrailing, profitTarget, maxDays, tickSize, NULL, 1,
+            inDollars, returnsBuffers[ii], results[ii]);
+   }
+   profile.convert();
+
+   // Concatenate the trades
+   std::vector<int>::size_type count = 0;
+   for(int ii = 0; ii < series; ++ii) {
+      profileTrades(profile, results[ii].ibeg, results[ii].iendOut, results[ii].reason);
+      count += results[ii].ibeg.size();
+   }
 
-   return Rcpp::NumericVector(result.begin(), result.end());
-}
\ No newline at end of file
+   Rcpp::IntegerVector seriesOut(count);
+   Rcpp::IntegerVector entry(count);
+   Rcpp::IntegerVector exit(count);
+   Rcpp::IntegerVector position(count);
+   Rcpp::NumericVector exitPrice(count);
+   Rcpp::NumericVector gain(count);
+   Rcpp::NumericVector minPrice(count);
+   Rcpp::NumericVector maxPrice(count);
+   Rcpp::NumericVector mae(count);
+   Rcpp::NumericVector mfe(count);
+   Rcpp::IntegerVector reason(count);
+
+   std::vector<int>::size_type jj = 0;
+   for(int ii = 0; ii < series; ++ii) {
+      const IndicatorTrades & res = results[ii];
+      for(std::vector<int>::size_type kk = 0; kk < res.ibeg.size(); ++kk, ++jj) {
+         // vectors in c++ are zero based and in R are one based
+         seriesOut[jj] = ii + 1;
+         entry[jj] = res.ibeg[kk] + 1;
+         exit[jj] = res.iendOut[kk] + 1;
+         position[jj] = res.position[kk];
+         exitPrice[jj] = res.exitPrice[kk];
+         gain[jj] = res.gain[kk];
+         minPrice[jj] = res.minPrice[kk];
+         maxPrice[jj] = res.maxPrice[kk];
+         mae[jj] = res.mae[kk];
+         mfe[jj] = res.mfe[kk];
+         reason[jj] = res.reason[kk];
+      }
+   }
+
+   Rcpp::RObject returnsOut;
+   if(withReturns) returnsOut = returns;
+
+   return Rcpp::List::create(
+               Rcpp::Named("trades") = Rcpp::DataFrame::create(
+                     Rcpp::Named("Series") = seriesOut,
+                     Rcpp::Named("Entry") = entry,
+                     Rcpp::Named("Exit") = exit,
+                     Rcpp::Named("Position") = position,
+                     Rcpp::Named("StopLoss") = Rcpp::NumericVector(count, stopLoss),
+                     Rcpp::Named("StopTrailing") = Rcpp::NumericVector(count, stopTrailing),
+                     Rcpp::Named("ProfitTarget") = Rcpp::NumericVector(count, profitTarget),
+                     Rcpp::Named("ExitPrice") = exitPrice,
+                     Rcpp::Named("Gain") = gain,
+                     Rcpp::Named("MinPrice") = minPrice,
+                     Rcpp::Named("MaxPrice") = maxPrice,
+                     Rcpp::Named("MAE") = mae,
+                     Rcpp::Named("MFE") = mfe,
+                     Rcpp::Named("Reason") = reason),
+               Rcpp::Named("returns") = returnsOut);
+}
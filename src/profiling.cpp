@@ -0,0 +1,152 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <Rcpp.h>
+#include <cstring>
+
+#include "common.h"
+#include "profiling.h"
+
+bool profilingEnabled = false;
+KernelCounters profilingCounters[PROFILE_KERNEL_COUNT];
+
+namespace
+{
+   // In the order of ProfiledKernel
+   const char * kernelNames[PROFILE_KERNEL_COUNT] = {
+      "process.trade",
+      "process.trades",
+      "sweep.trades",
+      "trade.indicator",
+      "trade.indicators",
+      "trades.from.indicator",
+      "calculate.returns",
+      "return.stats",
+      "bootstrap.returns",
+      "range.index",
+      "cap.trade.duration",
+      "construct.indicator",
+      "construct.indicators",
+      "indicator.from.trendline",
+      "zig.zag",
+      "zig.zags",
+      "locf",
+      "leading.na.rows",
+      "leading.nas",
+      "laguerre.filter",
+      "laguerre.rsi",
+      "laguerre.filter.rsi",
+      "laguerre.batch",
+      "rolling.window",
+      "returns.rsi"
+   };
+
+   // In the order of the exit reasons
+   const char * reasonNames[EXIT_REASON_COUNT] = {
+      "EXIT_ON_LAST",
+      "STOP_LIMIT_ON_OPEN",
+      "STOP_LIMIT_ON_HIGH",
+      "STOP_LIMIT_ON_LOW",
+      "STOP_LIMIT_ON_CLOSE",
+      "STOP_TRAILING_ON_OPEN",
+      "STOP_TRAILING_ON_HIGH",
+      "STOP_TRAILING_ON_LOW",
+      "STOP_TRAILING_ON_CLOSE",
+      "PROFIT_TARGET_ON_OPEN",
+      "PROFIT_TARGET_ON_HIGH",
+      "PROFIT_TARGET_ON_LOW",
+      "PROFIT_TARGET_ON_CLOSE",
+      "MAX_DAYS_LIMIT"
+   };
+}
+
+// [[Rcpp::export("profiling.reset.interface")]]
+void profilingResetInterface()
+{
+   std::memset(profilingCounters, 0, sizeof(profilingCounters));
+}
+
+// Returns the previous state
+// [[Rcpp::export("profiling.enable.interface")]]
+bool profilingEnableInterface(bool enable)
+{
+   bool res = profilingEnabled;
+   profilingEnabled = enable;
+   return res;
+}
+
+// The counters as a list of columns, a row per kernel
+// [[Rcpp::export("profiling.counters.interface")]]
+Rcpp::List profilingCountersInterface()
+{
+   Rcpp::CharacterVector kernel(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector calls(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector seconds(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector convertSeconds(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector computeSeconds(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector bars(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector trades(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector barsPerTrade(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector maxTradeBars(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericVector outputBytes(PROFILE_KERNEL_COUNT);
+   Rcpp::NumericMatrix reasons(PROFILE_KERNEL_COUNT, EXIT_REASON_COUNT);
+
+   for(int ii = 0; ii < PROFILE_KERNEL_COUNT; ++ii) {
+      const KernelCounters & cc = profilingCounters[ii];
+      kernel[ii] = kernelNames[ii];
+      calls[ii] = cc.calls;
+      seconds[ii] = cc.convertTime + cc.computeTime;
+      convertSeconds[ii] = cc.convertTime;
+      computeSeconds[ii] = cc.computeTime;
+      bars[ii] = cc.bars;
+      trades[ii] = cc.trades;
+      barsPerTrade[ii] = cc.trades > 0 ? cc.bars / cc.trades : NA_REAL;
+      maxTradeBars[ii] = cc.maxTradeBars;
+      outputBytes[ii] = cc.outputBytes;
+      for(int jj = 0; jj < EXIT_REASON_COUNT; ++jj) {
+         reasons(ii, jj) = cc.reasons[jj];
+      }
+   }
+
+   Rcpp::CharacterVector reasonColumns(EXIT_REASON_COUNT);
+   for(int jj = 0; jj < EXIT_REASON_COUNT; ++jj) reasonColumns[jj] = reasonNames[jj];
+
+   return Rcpp::List::create(
+               Rcpp::Named("counters") = Rcpp::DataFrame::create(
+                     Rcpp::Named("Kernel") = kernel,
+                     Rcpp::Named("Calls") = calls,
+                     Rcpp::Named("Seconds") = seconds,
+                     Rcpp::Named("ConvertSeconds") = convertSeconds,
+                     Rcpp::Named("ComputeSeconds") = computeSeconds,
+                     Rcpp::Named("Bars") = bars,
+                     Rcpp::Named("Trades") = trades,
+                     Rcpp::Named("BarsPerTrade") = barsPerTrade,
+                     Rcpp::Named("MaxTradeBars") = maxTradeBars,
+                     Rcpp::Named("OutputBytes") = outputBytes,
+                     Rcpp::Named("stringsAsFactors") = false),
+               Rcpp::Named("reasons") = reasons,
+               Rcpp::Named("reason.names") = reasonColumns);
+}
@@ -0,0 +1,162 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef PROFILING_H_INCLUDED
+#define PROFILING_H_INCLUDED
+
+#include <ctime>
+#include <cstddef>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "exitReasons.h"
+
+// Run-time instrumentation of the kernels, disabled by default. When disabled,
+// the cost is a branch per interface call. The counters are updated only from
+// the interface functions, which R calls on its main thread, thus, they need no
+// synchronization - the parallel loops inside the kernels are never touched.
+
+enum ProfiledKernel {
+   PROFILE_PROCESS_TRADE,
+   PROFILE_PROCESS_TRADES,
+   PROFILE_SWEEP_TRADES,
+   PROFILE_TRADE_INDICATOR,
+   PROFILE_TRADE_INDICATORS,
+   PROFILE_TRADES_FROM_INDICATOR,
+   PROFILE_CALCULATE_RETURNS,
+   PROFILE_RETURN_STATS,
+   PROFILE_BOOTSTRAP_RETURNS,
+   PROFILE_RANGE_INDEX,
+   PROFILE_CAP_TRADE_DURATION,
+   PROFILE_CONSTRUCT_INDICATOR,
+   PROFILE_CONSTRUCT_INDICATORS,
+   PROFILE_INDICATOR_FROM_TRENDLINE,
+   PROFILE_ZIG_ZAG,
+   PROFILE_ZIG_ZAG_MULTI,
+   PROFILE_LOCF,
+   PROFILE_LEADING_NA_ROWS,
+   PROFILE_LEADING_NAS,
+   PROFILE_LAGUERRE_FILTER,
+   PROFILE_LAGUERRE_RSI,
+   PROFILE_LAGUERRE_FILTER_RSI,
+   PROFILE_LAGUERRE_BATCH,
+   PROFILE_ROLLING_WINDOW,
+   PROFILE_RETURNS_RSI,
+   PROFILE_KERNEL_COUNT
+};
+
+struct KernelCounters {
+   double calls;
+   double convertTime;     // converting the inputs and the outputs
+   double computeTime;     // the kernel itself
+   double bars;            // the bars processed (scanned, for the trade kernels)
+   double trades;
+   double maxTradeBars;    // the longest scan of a single trade
+   double outputBytes;     // an estimate of the buffers the kernel and its interface allocate
+   double reasons[EXIT_REASON_COUNT];
+};
+
+extern bool profilingEnabled;
+extern KernelCounters profilingCounters[PROFILE_KERNEL_COUNT];
+
+// Wall time in seconds. Without OpenMP falls back to the processor time.
+inline double profilingClock()
+{
+#ifdef _OPENMP
+   return omp_get_wtime();
+#else
+   return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// Times an interface call, from construction to destruction. The time is
+// accounted as conversion until compute() is called, and again after convert()
+// is called. The bar, trade and output byte counts are added by the caller.
+// Does nothing if the profiling is disabled when constructed.
+class KernelProfile {
+public:
+   explicit KernelProfile(ProfiledKernel kernel)
+      : counters_(profilingEnabled ? &profilingCounters[kernel] : NULL), computing_(false), start_(0.0)
+   {
+      if(counters_ != NULL) {
+         counters_->calls += 1;
+         start_ = profilingClock();
+      }
+   }
+
+   ~KernelProfile() { phase(false); }
+
+   bool enabled() const { return counters_ != NULL; }
+
+   void compute() { phase(true); }
+   void convert() { phase(false); }
+
+   void bars(double count) { if(counters_ != NULL) counters_->bars += count; }
+   // The size of the outputs and of the main buffers, from their dimensions - an
+   // estimate, not a measurement. Temporary copies, the coercions of the inputs
+   // and the growth of the vectors are not counted.
+   void outputBytes(double bytes) { if(counters_ != NULL) counters_->outputBytes += bytes; }
+
+   // A processed trade, the bars it scanned and its exit reason
+   void trade(double bars, int reason)
+   {
+      if(counters_ == NULL) return;
+      counters_->trades += 1;
+      counters_->bars += bars;
+      if(bars > counters_->maxTradeBars) counters_->maxTradeBars = bars;
+      if(reason >= 0 && reason < EXIT_REASON_COUNT) counters_->reasons[reason] += 1;
+   }
+
+   // Summarized trades: their count, the bars they scanned, the bars scanned by
+   // the longest one and the counts by exit reason
+   void trades(double count, double bars, double maxBars, const int * reasons)
+   {
+      if(counters_ == NULL) return;
+      counters_->trades += count;
+      counters_->bars += bars;
+      if(maxBars > counters_->maxTradeBars) counters_->maxTradeBars = maxBars;
+      for(int ii = 0; ii < EXIT_REASON_COUNT; ++ii) counters_->reasons[ii] += reasons[ii];
+   }
+
+private:
+   void phase(bool computing)
+   {
+      if(counters_ == NULL) return;
+      double now = profilingClock();
+      if(computing_) counters_->computeTime += now - start_;
+      else counters_->convertTime += now - start_;
+      start_ = now;
+      computing_ = computing;
+   }
+
+   KernelCounters * counters_;
+   bool computing_;
+   double start_;
+};
+
+#endif // PROFILING_H_INCLUDED
@@ -0,0 +1,82 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef RANDOM_H_INCLUDED
+#define RANDOM_H_INCLUDED
+
+#include <stdint.h>
+#include <cmath>
+
+// A counter-based random generator: the value is a hash (the splitmix64
+// finalizer) of the seed, the stream and the position in the stream. Parallel
+// work uses a stream per item (i.e. per resample), thus, any thread can generate
+// it and the results don't depend on the number of threads, nor on the order of
+// processing.
+class CounterRng {
+public:
+   CounterRng(uint64_t seed, uint64_t stream)
+      : key_(mix(seed ^ mix(stream + UINT64_C(0x9E3779B97F4A7C15)))), counter_(0) {}
+
+   // Uniform in [0, 1)
+   double uniform()
+   {
+      return (next() >> 11) * (1.0 / 9007199254740992.0);
+   }
+
+   // Uniform in [0, n)
+   int index(int n)
+   {
+      int res = static_cast<int>(uniform() * n);
+      return res < n ? res : n - 1;
+   }
+
+   // Standard normal (Box-Muller)
+   double normal()
+   {
+      double u1 = 1.0 - uniform();
+      double u2 = uniform();
+      return std::sqrt(-2.0*std::log(u1)) * std::cos(6.283185307179586*u2);
+   }
+
+private:
+   static uint64_t mix(uint64_t z)
+   {
+      z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+      z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+      return z ^ (z >> 31);
+   }
+
+   uint64_t next()
+   {
+      ++counter_;
+      return mix(key_ + counter_ * UINT64_C(0x9E3779B97F4A7C15));
+   }
+
+   uint64_t key_;
+   uint64_t counter_;
+};
+
+#endif // RANDOM_H_INCLUDED
@@ -0,0 +1,189 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstring>
+
+#include "common.h"
+#include "barStore.h"
+#include "profiling.h"
+#include "rangeIndex.h"
+
+using namespace Rcpp;
+
+RangeIndex::RangeIndex(const DoubleView & op, const DoubleView & hi, const DoubleView & lo, const DoubleView & cl) :
+   bars_(cl.size()),
+   blocks_(0),
+   levels_(0),
+   usable_(true)
+{
+   sample(op, hi, lo, cl, sample_);
+
+   for(int ii = 0; ii < bars_ && usable_; ++ii) {
+      // The comparisons are false for NAs
+      usable_ = lo[ii] <= op[ii] && lo[ii] <= cl[ii] && hi[ii] >= op[ii] && hi[ii] >= cl[ii];
+   }
+
+   if(!usable_) return;
+
+   blocks_ = bars_ >> BLOCK_BITS;
+   while((1 << levels_) <= blocks_) ++levels_;
+
+   loMin_.resize(static_cast<std::size_t>(levels_)*blocks_);
+   hiMax_.resize(static_cast<std::size_t>(levels_)*blocks_);
+
+   // Level 0 - the blocks themselves. A partial last block is not indexed.
+   for(int bb = 0; bb < blocks_; ++bb) {
+      int ibeg = bb << BLOCK_BITS;
+      loMin_[bb] = *std::min_element(lo.begin() + ibeg, lo.begin() + ibeg + BLOCK_SIZE);
+      hiMax_[bb] = *std::max_element(hi.begin() + ibeg, hi.begin() + ibeg + BLOCK_SIZE);
+   }
+
+   for(int kk = 1; kk < levels_; ++kk) {
+      const double * loPrev = &loMin_[static_cast<std::size_t>(kk - 1)*blocks_];
+      const double * hiPrev = &hiMax_[static_cast<std::size_t>(kk - 1)*blocks_];
+      double * loCur = &loMin_[static_cast<std::size_t>(kk)*blocks_];
+      double * hiCur = &hiMax_[static_cast<std::size_t>(kk)*blocks_];
+      int half = 1 << (kk - 1);
+      for(int bb = 0; bb + 2*half <= blocks_; ++bb) {
+         loCur[bb] = std::min(loPrev[bb], loPrev[bb + half]);
+         hiCur[bb] = std::max(hiPrev[bb], hiPrev[bb + half]);
+      }
+   }
+}
+
+void RangeIndex::sample(
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         std::vector<double> & values)
+{
+   values.clear();
+   int bars = cl.size();
+   if(bars == 0) return;
+
+   // Evenly spaced, the first and the last included
+   int count = std::min(bars, SAMPLE_BARS);
+   for(int kk = 0; kk < count; ++kk) {
+      int ii = count > 1 ? static_cast<int>(static_cast<double>(kk)*(bars - 1)/(count - 1)) : 0;
+      values.push_back(op[ii]);
+      values.push_back(hi[ii]);
+      values.push_back(lo[ii]);
+      values.push_back(cl[ii]);
+   }
+}
+
+bool RangeIndex::matches(const DoubleView & op, const DoubleView & hi, const DoubleView & lo, const DoubleView & cl) const
+{
+   if(static_cast<int>(cl.size()) != bars_) return false;
+
+   std::vector<double> values;
+   sample(op, hi, lo, cl, values);
+
+   // Bitwise, thus, NAs match NAs
+   return values.size() == sample_.size() &&
+            (values.empty() || std::memcmp(&values[0], &sample_[0], values.size()*sizeof(double)) == 0);
+}
+
+int RangeIndex::firstCross(
+         const DoubleView & hi,
+         const DoubleView & lo,
+         int from,
+         int to,
+         double loLevel,
+         double hiLevel,
+         double & minLo,
+         double & maxHi) const
+{
+   int ii = from;
+
+   // Bar by bar up to the first block boundary
+   for(; ii <= to && (ii & (BLOCK_SIZE - 1)) != 0; ++ii) {
+      if(lo[ii] <= loLevel || hi[ii] >= hiLevel) return ii;
+      minLo = std::min(lo[ii], minLo);
+      maxHi = std::max(hi[ii], maxHi);
+   }
+
+   if(ii > to) return ii;
+
+   // Jump over the longest run of whole blocks which don't cross either level.
+   // Decreasing powers of two add up to the length of the run.
+   int bb = ii >> BLOCK_BITS;
+   int end = std::min((to + 1) >> BLOCK_BITS, blocks_);
+   for(int kk = levels_ - 1; kk >= 0; --kk) {
+      if(bb + (1 << kk) > end) continue;
+
+      std::size_t id = static_cast<std::size_t>(kk)*blocks_ + bb;
+      if(loMin_[id] > loLevel && hiMax_[id] < hiLevel) {
+         minLo = std::min(loMin_[id], minLo);
+         maxHi = std::max(hiMax_[id], maxHi);
+         bb += 1 << kk;
+      }
+   }
+
+   // Bar by bar within the block which crosses (or the partial last block)
+   for(ii = std::max(ii, bb << BLOCK_BITS); ii <= to; ++ii) {
+      if(lo[ii] <= loLevel || hi[ii] >= hiLevel) return ii;
+      minLo = std::min(lo[ii], minLo);
+      maxHi = std::max(hi[ii], maxHi);
+   }
+
+   return ii;
+}
+
+const RangeIndex * rangeIndex(
+         SEXP indexIn,
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl)
+{
+   if(Rf_isNull(indexIn)) return NULL;
+   if(TYPEOF(indexIn) != EXTPTRSXP || !Rf_inherits(indexIn, "range.index")) Rcpp::stop("Not a range index");
+
+   Rcpp::XPtr<RangeIndex> ptr(indexIn);
+   if(!ptr->matches(op, hi, lo, cl)) Rcpp::stop("The range index was built on a different ohlc series");
+
+   return ptr.get();
+}
+
+// [[Rcpp::export("range.index.interface")]]
+SEXP rangeIndexInterface(SEXP ohlcIn)
+{
+   KernelProfile profile(PROFILE_RANGE_INDEX);
+
+   OhlcViews ohlc = ohlcViews(ohlcIn);
+
+   profile.compute();
+   RangeIndex * index = new RangeIndex(ohlc.op, ohlc.hi, ohlc.lo, ohlc.cl);
+   profile.convert();
+   profile.bars(ohlc.cl.size());
+
+   Rcpp::XPtr<RangeIndex> ptr(index, true);
+   ptr.attr("class") = "range.index";
+   return ptr;
+}
@@ -0,0 +1,104 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef RANGE_INDEX_H_INCLUDED
+#define RANGE_INDEX_H_INCLUDED
+
+#include <vector>
+
+#include "common.h"
+
+// Range minimum of the lows and range maximum of the highs of an OHLC series.
+// The bars are grouped in blocks of 64 and a sparse table is built over the
+// block minima/maxima, so the memory is a small fraction of the series.
+//
+// Used to skip the bars of a trade which can't trigger a fixed level (a stop
+// loss or a profit target): the first bar crossing a level is found by jumping
+// over power-of-two runs of blocks, plus at most two partial blocks.
+class RangeIndex {
+public:
+   RangeIndex(const DoubleView & op, const DoubleView & hi, const DoubleView & lo, const DoubleView & cl);
+
+   // The index is not usable if the series has NAs, or if the open or the
+   // close of a bar is outside its low-high range. In these cases the lows
+   // and the highs don't tell whether a bar triggers an exit.
+   bool usable() const { return usable_; }
+   int size() const { return bars_; }
+
+   // Whether the series is the one the index was built on, as far as the length
+   // and a sample of the bars (the first, the last and a few in between) tell.
+   // The values are compared, not the addresses - a series coerced again, or a
+   // bar store mapped again, is the same series at a new address.
+   bool matches(const DoubleView & op, const DoubleView & hi, const DoubleView & lo, const DoubleView & cl) const;
+
+   // Returns the first bar in [from, to] with low <= loLevel or high >= hiLevel,
+   // to + 1 if there is none. minLo and maxHi are updated with the lows and
+   // the highs of the bars before the returned one.
+   int firstCross(
+         const DoubleView & hi,
+         const DoubleView & lo,
+         int from,
+         int to,
+         double loLevel,
+         double hiLevel,
+         double & minLo,
+         double & maxHi) const;
+
+private:
+   static const int BLOCK_BITS = 6;
+   static const int BLOCK_SIZE = 1 << BLOCK_BITS;
+   static const int SAMPLE_BARS = 16;
+
+   static void sample(
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl,
+         std::vector<double> & values);
+
+   int bars_;
+   int blocks_;
+   int levels_;
+   bool usable_;
+
+   // Level k holds the min/max over 2^k blocks, starting at each block
+   std::vector<double> loMin_;
+   std::vector<double> hiMax_;
+
+   // The sampled bars of the series, see matches
+   std::vector<double> sample_;
+};
+
+// The index passed from R (an external pointer created by range.index.interface),
+// NULL for R's NULL. Stops if the index was built on a different series.
+const RangeIndex * rangeIndex(
+         SEXP indexIn,
+         const DoubleView & op,
+         const DoubleView & hi,
+         const DoubleView & lo,
+         const DoubleView & cl);
+
+#endif // RANGE_INDEX_H_INCLUDED
@@ -0,0 +1,123 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef STATS_H_INCLUDED
+#define STATS_H_INCLUDED
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "common.h"
+
+// Mean and standard deviation in a single pass (Welford), numerically stable
+// for long series.
+class RunningStats {
+public:
+   RunningStats() : count_(0), mean_(0.0), m2_(0.0) {}
+
+   void add(double x)
+   {
+      ++count_;
+      double delta = x - mean_;
+      mean_ += delta / count_;
+      m2_ += delta * (x - mean_);
+   }
+
+   int count() const { return count_; }
+   double mean() const { return count_ > 0 ? mean_ : NA_REAL; }
+
+   // The sample standard deviation, as sd() in R
+   double sd() const { return count_ > 1 ? std::sqrt(m2_ / (count_ - 1)) : NA_REAL; }
+
+   // The mean over the standard deviation, multiplied by sqrt(scale) to
+   // annualize. NA if the standard deviation is zero or undefined.
+   double sharpe(double scale = 1.0) const
+   {
+      double dev = sd();
+      if(count_ < 2 || !(dev > 0.0)) return NA_REAL;
+      return mean_ / dev * std::sqrt(scale);
+   }
+
+private:
+   int count_;
+   double mean_;
+   double m2_;
+};
+
+// Tracks the equity of a series of returns, with its running peak and the
+// maximum drawdown. Compounded returns multiply the equity (starting at 1)
+// and the drawdown is a fraction of the peak. Otherwise the returns are added
+// (starting at 0) and the drawdown is in the units of the returns. The
+// duration of a drawdown is the number of bars below the peak.
+class EquityTracker {
+public:
+   explicit EquityTracker(bool compound)
+      : compound_(compound), equity_(compound ? 1.0 : 0.0), peak_(equity_), maxDrawdown_(0.0),
+        underwater_(0), maxDuration_(0) {}
+
+   void add(double ret)
+   {
+      if(compound_) equity_ *= 1.0 + ret;
+      else equity_ += ret;
+
+      if(equity_ >= peak_) {
+         peak_ = equity_;
+         underwater_ = 0;
+      } else {
+         double dd = compound_ ? (peak_ > 0.0 ? 1.0 - equity_/peak_ : 0.0) : peak_ - equity_;
+         if(dd > maxDrawdown_) maxDrawdown_ = dd;
+         if(++underwater_ > maxDuration_) maxDuration_ = underwater_;
+      }
+   }
+
+   double equity() const { return equity_; }
+   double peak() const { return peak_; }
+   double maxDrawdown() const { return maxDrawdown_; }
+   int maxDrawdownDuration() const { return maxDuration_; }
+
+private:
+   bool compound_;
+   double equity_;
+   double peak_;
+   double maxDrawdown_;
+   int underwater_;
+   int maxDuration_;
+};
+
+// Sample quantile, the same as quantile(x, prob, type=7) in R. The values must
+// be sorted, without NAs.
+inline double sortedQuantile(const std::vector<double> & sorted, double prob)
+{
+   if(sorted.empty()) return NA_REAL;
+
+   double h = (sorted.size() - 1) * prob;
+   std::size_t lo = static_cast<std::size_t>(std::floor(h));
+   std::size_t hi = std::min(lo + 1, sorted.size() - 1);
+   return sorted[lo] + (h - lo)*(sorted[hi] - sorted[lo]);
+}
+
+#endif // STATS_H_INCLUDED
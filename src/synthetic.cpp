@@ -0,0 +1,180 @@
+//  Copyright (c) 2013-2014, Ivan Popivanov
+//  
+//  Redistribution and use in source and binary forms, with or without
+//  modification, are permitted provided that the following conditions are
+//  met:
+//  
+//      Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//  
+//      Redistributions in binary form must reproduce the above copyright
+//      notice, this list of conditions and the following disclaimer in
+//      the documentation and/or other materials provided with the
+//      distribution.
+//  
+//  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+//  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+//  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+//  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+//  HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+//  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+//  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+//  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+//  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+//  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <Rcpp.h>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "common.h"
+#include "random.h"
+
+// Deterministic synthetic data for the benchmarks and the tests. The same seed
+// produces the same series, regardless of the number of threads.
+
+// The bars are generated in blocks, each block from its own random stream
+#define SYNTHETIC_BLOCK 65536
+
+// A geometric random walk. The close moves by a normal log-return with the
+// given volatility, the open gaps from the previous close by a tenth of it, and
+// the high and the low extend beyond the open and the close by up to half of it.
+// The output columns must have the same size.
+void syntheticOhlc(
+         double * op,
+         double * hi,
+         double * lo,
+         double * cl,
+         int bars,
+         double start,
+         double volatility,
+         uint64_t seed,
+         int threads)
+{
+   if(bars <= 0) return;
+
+   int blocks = (bars + SYNTHETIC_BLOCK - 1) / SYNTHETIC_BLOCK;
+
+   // The random parts, stored temporarily in the outputs: the close to close
+   // ratio in cl, the gap in op and the range extensions in hi and lo.
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(static)
+   for(int bb = 0; bb < blocks; ++bb) {
+      CounterRng rng(seed, bb);
+      int iend = std::min(bars, (bb + 1)*SYNTHETIC_BLOCK);
+      for(int ii = bb*SYNTHETIC_BLOCK; ii < iend; ++ii) {
+         cl[ii] = std::exp(volatility*rng.normal());
+         op[ii] = std::exp(0.1*volatility*rng.normal());
+         hi[ii] = 0.5*volatility*rng.uniform();
+         lo[ii] = 0.5*volatility*rng.uniform();
+      }
+   }
+
+   // The walk itself is sequential
+   double prev = start;
+   for(int ii = 0; ii < bars; ++ii) {
+      double gap = op[ii];
+      op[ii] = prev*gap;
+      prev *= cl[ii];
+      cl[ii] = prev;
+   }
+
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(static)
+   for(int ii = 0; ii < bars; ++ii) {
+      hi[ii] = std::max(op[ii], cl[ii])*(1.0 + hi[ii]);
+      lo[ii] = std::min(op[ii], cl[ii])*(1.0 - lo[ii]);
+   }
+}
+
+// [[Rcpp::export("synthetic.ohlc.interface")]]
+Rcpp::NumericMatrix syntheticOhlcInterface(int bars, double start, double volatility, double seed, int threads)
+{
+   Rcpp::NumericMatrix result(bars, 4);
+   double * base = result.begin();
+   syntheticOhlc(base, base + bars, base + 2*static_cast<std::size_t>(bars), base + 3*static_cast<std::size_t>(bars),
+                 bars, start, volatility, static_cast<uint64_t>(seed), threads);
+   return result;
+}
+
+// Trades with uniformly spread entries and random durations in [minDuration,
+// maxDuration] bars. All trades end within the series. The position is long or
+// short at random. The indexes are zero based.
+void syntheticTrades(
+         int bars,
+         int trades,
+         int minDuration,
+         int maxDuration,
+         uint64_t seed,
+         std::vector<int> & ibeg,
+         std::vector<int> & iend,
+         std::vector<int> & position)
+{
+   ibeg.resize(trades);
+   iend.resize(trades);
+   position.resize(trades);
+
+   if(minDuration < 1) minDuration = 1;
+   if(maxDuration < minDuration) maxDuration = minDuration;
+   int last = std::max(0, bars - 1 - maxDuration);
+
+   CounterRng rng(seed, 0);
+   for(int ii = 0; ii < trades; ++ii) {
+      ibeg[ii] = trades > 1 ? static_cast<int>(static_cast<double>(ii)*last/(trades - 1)) : 0;
+      iend[ii] = std::min(bars - 1, ibeg[ii] + minDuration + rng.index(maxDuration - minDuration + 1));
+      position[ii] = rng.index(2) == 0 ? 1 : -1;
+   }
+}
+
+// [[Rcpp::export("synthetic.trades.interface")]]
+Rcpp::DataFrame syntheticTradesInterface(int bars, int trades, int minDuration, int maxDuration, double seed)
+{
+   std::vector<int> ibeg;
+   std::vector<int> iend;
+   std::vector<int> position;
+   syntheticTrades(bars, trades, minDuration, maxDuration, static_cast<uint64_t>(seed), ibeg, iend, position);
+
+   // vectors in c++ are zero based and in R are one based.
+   for(std::vector<int>::size_type ii = 0; ii < ibeg.size(); ++ii)
+   {
+      ibeg[ii] += 1;
+      iend[ii] += 1;
+   }
+
+   return Rcpp::DataFrame::create(
+               Rcpp::Named("Entry") = ibeg,
+               Rcpp::Named("Exit") = iend,
+               Rcpp::Named("Position") = position);
+}
+
+// An indicator (-1, 0 or 1) changing its value after runs of random length, with
+// the given mean. Consecutive runs have different values.
+void syntheticIndicator(double * indicator, int bars, double meanDuration, bool withFlat, uint64_t seed)
+{
+   CounterRng rng(seed, 0);
+
+   int maxRun = std::max(1, static_cast<int>(2.0*meanDuration) - 1);
+   double value = rng.index(2) == 0 ? 1.0 : -1.0;
+
+   int ii = 0;
+   while(ii < bars) {
+      int iend = std::min(bars, ii + 1 + rng.index(maxRun));
+      for(; ii < iend; ++ii) indicator[ii] = value;
+
+      if(withFlat) {
+         double next = value;
+         while(next == value) next = rng.index(3) - 1.0;
+         value = next;
+      } else {
+         value = -value;
+      }
+   }
+}
+
+// [[Rcpp::export("synthetic.indicator.interface")]]
+Rcpp::NumericVector syntheticIndicatorInterface(int bars, double meanDuration, bool withFlat, double seed)
+{
+   Rcpp::NumericVector result(bars);
+   syntheticIndicator(result.begin(), bars, meanDuration, withFlat, static_cast<uint64_t>(seed));
+   return result;
+}
@@ -26,120 +26,593 @@
 
 
 #include <Rcpp.h>
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <vector>
+
 #include "common.h"
+#include "laguerre.h"
+#include "profiling.h"
 
 using namespace Rcpp;
 
-void locf(std::vector<double> & v, double value) {
+// Fills a column in place: carries the last value forward over the NAs, or over
+// the elements equal to value when it's not NA. A column without NAs inside its
+// valid range goes through the loops without the NA checks.
+void locf(double * v, std::size_t len, double value) {
+   NARange range = naRange(DoubleView(v, len));
+   if(range.first == len) return;
+
    if(!isNA(value)) {
-      for(std::vector<double>::size_type ii = 1; ii < v.size(); ++ii) {
-         if(!isNA(v[ii-1]) && v[ii] == value) v[ii] = v[ii-1];
+      if(range.gaps) {
+         for(std::size_t ii = range.first + 1; ii < len; ++ii) {
+            if(!isNA(v[ii-1]) && v[ii] == value) v[ii] = v[ii-1];
+         }
+      } else {
+         // Outside the range the NAs don't change
+         for(std::size_t ii = range.first + 1; ii <= range.last; ++ii) {
+            v[ii] = v[ii] == value ? v[ii-1] : v[ii];
+         }
       }
    } else {
       // na.locf behaviour
-      for(std::vector<double>::size_type ii = 1; ii < v.size(); ++ii) {
-         if(isNA(v[ii]) && !isNA(v[ii-1])) v[ii] = v[ii-1];
+      if(range.gaps) {
+         for(std::size_t ii = range.first + 1; ii < len; ++ii) {
+            if(isNA(v[ii]) && !isNA(v[ii-1])) v[ii] = v[ii-1];
+         }
+      } else {
+         // Only the trailing NAs to fill
+         std::fill(v + range.last + 1, v + len, v[range.last]);
       }
    }
 }
 
+// locf of a vector, or of each column of a matrix. The result is a copy of the
+// input (with its attributes), filled in place, a column per task.
 // [[Rcpp::export("locf.interface")]]
-Rcpp::NumericVector locfInterface(SEXP vin, double value)
+Rcpp::NumericVector locfInterface(SEXP vin, double value, int threads)
 {
-   std::vector<double> v = Rcpp::as< std::vector<double> >(vin);
-   locf(v, value);
+   KernelProfile profile(PROFILE_LOCF);
+
+   // A single copy - the coercion already makes one for non-doubles
+   Rcpp::NumericVector v(TYPEOF(vin) == REALSXP ? Rcpp::clone(vin) : vin);
+
+   // The number of rows of a matrix, the length of a vector
+   int rows = Rf_nrows(v);
+   int cols = rows > 0 ? v.size() / rows : 0;
+   double * data = v.begin();
+
+   profile.compute();
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(static)
+   for(int col = 0; col < cols; ++col) {
+      locf(data + static_cast<std::size_t>(col)*rows, rows, value);
+   }
+   profile.convert();
+   profile.bars(v.size());
+   profile.outputBytes(v.size()*sizeof(double));
+
+   return v;
+}
+
+// The number of leading rows of a matrix (elements of a vector) with an NA in
+// any column, the rows na.trim removes from the start. As is.na in na.trim, a
+// NaN counts as an NA.
+// [[Rcpp::export("leading.na.rows.interface")]]
+int leadingNARows(SEXP vin)
+{
+   KernelProfile profile(PROFILE_LEADING_NA_ROWS);
+
+   Rcpp::NumericVector v(vin);
+   int rows = Rf_nrows(v);
+   int cols = rows > 0 ? v.size() / rows : 0;
+   const double * data = v.begin();
+
+   profile.compute();
+
+   // The rows before the first non-NA of each column, then the rows after with
+   // an NA in some column (not after a locf in NA mode)
+   int res = 0;
+   for(int col = 0; col < cols; ++col) {
+      const double * column = data + static_cast<std::size_t>(col)*rows;
+      int ii = res;
+      while(ii < rows && ISNAN(column[ii])) ++ii;
+      res = ii;
+   }
+
+   for(; res < rows; ++res) {
+      int col = 0;
+      while(col < cols && !ISNAN(data[static_cast<std::size_t>(col)*rows + res])) ++col;
+      if(col == cols) break;
+   }
+   profile.convert();
+   profile.bars(static_cast<double>(res)*cols);
 
-   return Rcpp::NumericVector(v.begin(), v.end());
+   return res;
 }
 
 // [[Rcpp::export("leading.nas.interface")]]
 double leadingNAs(SEXP vin)
 {
+   KernelProfile profile(PROFILE_LEADING_NAS);
+
    std::vector<double> v = Rcpp::as< std::vector<double> >(vin);
    std::vector<double>::size_type ii = 0;
+   profile.compute();
    while(ii < v.size() && isNA(v[ii])) ++ii;
+   profile.convert();
+   profile.bars(ii);
+   profile.outputBytes(v.size()*sizeof(double));
 
    return ii;
 }
 
-void laguerreFilter(const std::vector<double> & prices, double gamma, std::vector<double> & out)
+// The Laguerre filter and/or RSI of the prices, in a single pass with O(1)
+// state. The outputs have room for prices.size() elements, NULL to skip one.
+void laguerre(const DoubleView & prices, double gamma, double * filter, double * rsi)
 {
-   out.resize(prices.size());
+   LaguerreState state;
+   for(DoubleView::size_type jj = 0; jj < prices.size(); ++jj) {
+      state.update(prices[jj], gamma);
+      if(filter != NULL) filter[jj] = laguerreFilterValue(state.l0, state.l1, state.l2, state.l3);
+      if(rsi != NULL) rsi[jj] = laguerreRSIValue(state.l0, state.l1, state.l2, state.l3);
+   }
+}
 
-   std::vector<double> l0(prices.size(), 0.0);
-   std::vector<double> l1(prices.size(), 0.0);
-   std::vector<double> l2(prices.size(), 0.0);
-   std::vector<double> l3(prices.size(), 0.0);
-   
-   for(int jj = 1; jj < 4; ++jj) l0[jj] = (1.0 - gamma)*prices[jj] + gamma*l0[jj-1];
-   for(int jj = 2; jj < 4; ++jj) l1[jj] = -gamma*l0[jj] + l0[jj-1] + gamma*l1[jj-1];
-   l2[3] = -gamma*l1[3] + l1[2] + gamma*l2[2];
-   
-   for(std::vector<double>::size_type jj = 4; jj < prices.size(); ++jj) {
-      l0[jj] = (1.0 - gamma)*prices[jj] + gamma*l0[jj-1];
-      l1[jj] = -gamma*l0[jj] + l0[jj-1] + gamma*l1[jj-1];
-      l2[jj] = -gamma*l1[jj] + l1[jj-1] + gamma*l2[jj-1];
-      l3[jj] = -gamma*l2[jj] + l2[jj-1] + gamma*l3[jj-1];
+// The shortest chunk worth a thread in laguerreChunked
+static const std::size_t LAGUERRE_MIN_CHUNK = 1 << 16;
+
+// A linear map of the cascade's state (l0, l1, l2, l3)
+struct LaguerreMatrix {
+   double m[4][4];
+};
+
+static LaguerreMatrix multiply(const LaguerreMatrix & a, const LaguerreMatrix & b)
+{
+   LaguerreMatrix res;
+   for(int ii = 0; ii < 4; ++ii) {
+      for(int jj = 0; jj < 4; ++jj) {
+         double sum = 0.0;
+         for(int kk = 0; kk < 4; ++kk) sum += a.m[ii][kk]*b.m[kk][jj];
+         res.m[ii][jj] = sum;
+      }
+   }
+   return res;
+}
+
+// A^bars, where A is the update of the started cascade with a zero price
+static LaguerreMatrix laguerrePower(double gamma, std::size_t bars)
+{
+   LaguerreMatrix step, res;
+   for(int jj = 0; jj < 4; ++jj) {
+      LaguerreState state;
+      state.l0 = jj == 0 ? 1.0 : 0.0;
+      state.l1 = jj == 1 ? 1.0 : 0.0;
+      state.l2 = jj == 2 ? 1.0 : 0.0;
+      state.l3 = jj == 3 ? 1.0 : 0.0;
+      state.bars = 4;
+      state.update(0.0, gamma);
+      step.m[0][jj] = state.l0;
+      step.m[1][jj] = state.l1;
+      step.m[2][jj] = state.l2;
+      step.m[3][jj] = state.l3;
+      for(int ii = 0; ii < 4; ++ii) res.m[ii][jj] = ii == jj ? 1.0 : 0.0;
+   }
+
+   for(; bars > 0; bars >>= 1) {
+      if(bars & 1) res = multiply(res, step);
+      step = multiply(step, step);
+   }
+   return res;
+}
+
+// laguerre for a single long series, split in chunks processed in parallel.
+// Once started, the cascade is linear: s' = A*s + c*price. Thus, the state at
+// the end of a chunk is the end state of the chunk run from a zero state, plus
+// A^n (n the chunk's length) times the state entering the chunk. The zero state
+// runs go in parallel, the entry states are chained in order, then each chunk
+// is run again from its entry state, in parallel, to produce the outputs. The
+// result matches laguerre up to rounding; short series are done serially.
+void laguerreChunked(const DoubleView & prices, double gamma, double * filter, double * rsi, int threads)
+{
+   std::size_t len = prices.size();
+   int chunks = static_cast<int>(std::min<std::size_t>(threadCount(threads), len / LAGUERRE_MIN_CHUNK));
+   if(chunks < 2) {
+      laguerre(prices, gamma, filter, rsi);
+      return;
+   }
+
+   // The warm-up, while the stages start
+   std::vector<LaguerreState> entries(chunks);
+   LaguerreState & state = entries[0];
+   std::size_t warmup = 4;
+   for(std::size_t jj = 0; jj < warmup; ++jj) {
+      state.update(prices[jj], gamma);
+      if(filter != NULL) filter[jj] = laguerreFilterValue(state.l0, state.l1, state.l2, state.l3);
+      if(rsi != NULL) rsi[jj] = laguerreRSIValue(state.l0, state.l1, state.l2, state.l3);
+   }
+
+   std::size_t chunkSize = (len - warmup + chunks - 1) / chunks;
+   std::vector<LaguerreState> ends(chunks);
+   std::vector<LaguerreMatrix> powers(chunks);
+
+   // The last chunk's end state isn't needed
+   #pragma omp parallel for num_threads(chunks)
+   for(int kk = 0; kk < chunks - 1; ++kk) {
+      std::size_t first = std::min(len, warmup + kk*chunkSize);
+      std::size_t last = std::min(len, first + chunkSize);
+      LaguerreState zero;
+      zero.bars = 4;
+      for(std::size_t jj = first; jj < last; ++jj) zero.update(prices[jj], gamma);
+      ends[kk] = zero;
+      powers[kk] = laguerrePower(gamma, last - first);
+   }
+
+   for(int kk = 1; kk < chunks; ++kk) {
+      const LaguerreMatrix & pp = powers[kk - 1];
+      const LaguerreState & in = entries[kk - 1];
+      LaguerreState & out = entries[kk];
+      out.l0 = ends[kk - 1].l0 + pp.m[0][0]*in.l0 + pp.m[0][1]*in.l1 + pp.m[0][2]*in.l2 + pp.m[0][3]*in.l3;
+      out.l1 = ends[kk - 1].l1 + pp.m[1][0]*in.l0 + pp.m[1][1]*in.l1 + pp.m[1][2]*in.l2 + pp.m[1][3]*in.l3;
+      out.l2 = ends[kk - 1].l2 + pp.m[2][0]*in.l0 + pp.m[2][1]*in.l1 + pp.m[2][2]*in.l2 + pp.m[2][3]*in.l3;
+      out.l3 = ends[kk - 1].l3 + pp.m[3][0]*in.l0 + pp.m[3][1]*in.l1 + pp.m[3][2]*in.l2 + pp.m[3][3]*in.l3;
+      out.bars = 4;
+   }
+
+   #pragma omp parallel for num_threads(chunks)
+   for(int kk = 0; kk < chunks; ++kk) {
+      std::size_t first = std::min(len, warmup + kk*chunkSize);
+      std::size_t last = std::min(len, first + chunkSize);
+      LaguerreState state = entries[kk];
+      for(std::size_t jj = first; jj < last; ++jj) {
+         state.update(prices[jj], gamma);
+         if(filter != NULL) filter[jj] = laguerreFilterValue(state.l0, state.l1, state.l2, state.l3);
+         if(rsi != NULL) rsi[jj] = laguerreRSIValue(state.l0, state.l1, state.l2, state.l3);
+      }
    }
-   
-   for(std::vector<double>::size_type jj = 0; jj < prices.size(); ++jj) out[jj] = (l0[jj] + 2.0*l1[jj] + 2.0*l2[jj] + l3[jj]) / 6.0;
 }
 
 // [[Rcpp::export("laguerre.filter.interface")]]
-Rcpp::NumericVector laguerreFilterInterface(SEXP vin, double gamma)
+Rcpp::NumericVector laguerreFilterInterface(SEXP vin, double gamma, int threads)
 {
-   std::vector<double> v = Rcpp::as< std::vector<double> >(vin);
-   std::vector<double> vout;
+   KernelProfile profile(PROFILE_LAGUERRE_FILTER);
+
+   Rcpp::NumericVector v(vin);
+   Rcpp::NumericVector vout(v.size());
    
-   laguerreFilter(v, gamma, vout);
+   profile.compute();
+   laguerreChunked(doubleView(v), gamma, vout.begin(), NULL, threads);
+   profile.convert();
+   profile.bars(v.size());
+   profile.outputBytes(v.size()*sizeof(double));
 
-   return Rcpp::NumericVector(vout.begin(), vout.end());
+   return vout;
 }
 
-void laguerreRSI(const std::vector<double> & prices, double gamma, std::vector<double> & rsi)
+// [[Rcpp::export("laguerre.rsi.interface")]]
+Rcpp::NumericVector laguerreRSIInterface(SEXP vin, double gamma, int threads)
 {
-   rsi.resize(prices.size());
+   KernelProfile profile(PROFILE_LAGUERRE_RSI);
 
-   std::vector<double> l0(prices.size(), 0.0);
-   std::vector<double> l1(prices.size(), 0.0);
-   std::vector<double> l2(prices.size(), 0.0);
-   std::vector<double> l3(prices.size(), 0.0);
+   Rcpp::NumericVector v(vin);
+   Rcpp::NumericVector rsi(v.size());
    
-   for(int jj = 1; jj < 4; ++jj) l0[jj] = (1.0 - gamma)*prices[jj] + gamma*l0[jj-1];
-   for(int jj = 2; jj < 4; ++jj) l1[jj] = -gamma*l0[jj] + l0[jj-1] + gamma*l1[jj-1];
-   l2[3] = -gamma*l1[3] + l1[2] + gamma*l2[2];
-   
-   for(std::vector<double>::size_type jj = 4; jj < prices.size(); ++jj) {
-      l0[jj] = (1.0 - gamma)*prices[jj] + gamma*l0[jj-1];
-      l1[jj] = -gamma*l0[jj] + l0[jj-1] + gamma*l1[jj-1];
-      l2[jj] = -gamma*l1[jj] + l1[jj-1] + gamma*l2[jj-1];
-      l3[jj] = -gamma*l2[jj] + l2[jj-1] + gamma*l3[jj-1];
+   profile.compute();
+   laguerreChunked(doubleView(v), gamma, NULL, rsi.begin(), threads);
+   profile.convert();
+   profile.bars(v.size());
+   profile.outputBytes(v.size()*sizeof(double));
+
+   return rsi;
+}
+
+// The number of gammas updated together, in SIMD lanes
+static const int LAGUERRE_LANES = 8;
+
+// laguerre for up to LAGUERRE_LANES gammas on the same prices. The cascades of
+// all gammas are updated together, in a loop over the lanes which the compiler
+// vectorizes. The outputs of a gamma are stride elements after the previous.
+// The lanes match LaguerreState::update up to rounding, not bit for bit - the
+// compiler may contract the vectorized loop differently (i.e. into FMAs).
+static void laguerreLanes(
+               const DoubleView & prices,
+               const double * gammas,
+               int lanes,
+               double * filter,
+               double * rsi,
+               std::size_t stride)
+{
+   double gg[LAGUERRE_LANES], l0[LAGUERRE_LANES], l1[LAGUERRE_LANES], l2[LAGUERRE_LANES], l3[LAGUERRE_LANES];
+   double ff[LAGUERRE_LANES], rr[LAGUERRE_LANES];
+
+   // The first bars, while the stages start, lane by lane
+   std::size_t len = prices.size();
+   std::size_t warmup = std::min<std::size_t>(len, 4);
+   for(int kk = 0; kk < LAGUERRE_LANES; ++kk) {
+      gg[kk] = kk < lanes ? gammas[kk] : 0.0;
+
+      LaguerreState state;
+      for(std::size_t jj = 0; jj < warmup; ++jj) {
+         state.update(prices[jj], gg[kk]);
+         if(kk >= lanes) continue;
+         if(filter != NULL) filter[kk*stride + jj] = laguerreFilterValue(state.l0, state.l1, state.l2, state.l3);
+         if(rsi != NULL) rsi[kk*stride + jj] = laguerreRSIValue(state.l0, state.l1, state.l2, state.l3);
+      }
+      l0[kk] = state.l0;
+      l1[kk] = state.l1;
+      l2[kk] = state.l2;
+      l3[kk] = state.l3;
    }
-   
-   for(std::vector<double>::size_type jj = 0; jj < prices.size(); ++jj) {
-      double cu = 0.0;
-      double cd = 0.0;
 
-      if(l0[jj] > l1[jj]) cu = l0[jj] - l1[jj];
-      else cd = l1[jj] - l0[jj];
+   for(std::size_t jj = warmup; jj < len; ++jj) {
+      double price = prices[jj];
 
-      if(l1[jj] > l2[jj]) cu += l1[jj] - l2[jj];
-      else cd += l2[jj] - l1[jj];
+      #pragma omp simd
+      for(int kk = 0; kk < LAGUERRE_LANES; ++kk) {
+         double gamma = gg[kk];
+         double n0 = (1.0 - gamma)*price + gamma*l0[kk];
+         double n1 = -gamma*n0 + l0[kk] + gamma*l1[kk];
+         double n2 = -gamma*n1 + l1[kk] + gamma*l2[kk];
+         double n3 = -gamma*n2 + l2[kk] + gamma*l3[kk];
+         l0[kk] = n0;
+         l1[kk] = n1;
+         l2[kk] = n2;
+         l3[kk] = n3;
+         ff[kk] = laguerreFilterValue(n0, n1, n2, n3);
+         rr[kk] = laguerreRSIValue(n0, n1, n2, n3);
+      }
 
-      if(l2[jj] > l3[jj]) cu += l2[jj] - l3[jj];
-      else cd += l3[jj] - l2[jj];
-      
-      if((cu + cd) > 0.0) rsi[jj] = cu / (cu + cd);
+      for(int kk = 0; kk < lanes; ++kk) {
+         if(filter != NULL) filter[kk*stride + jj] = ff[kk];
+         if(rsi != NULL) rsi[kk*stride + jj] = rr[kk];
+      }
    }
 }
 
-// [[Rcpp::export("laguerre.rsi.interface")]]
-Rcpp::NumericVector laguerreRSIInterface(SEXP vin, double gamma)
+// laguerre for each column of a matrix (or a single vector) and each gamma.
+// Returns a list with a 3-D array (bar, column, gamma) for the filter and for
+// the RSI, NULL if not requested.
+// [[Rcpp::export("laguerre.batch.interface")]]
+Rcpp::List laguerreBatchInterface(SEXP xIn, SEXP gammasIn, bool withFilter, bool withRSI, int threads)
 {
-   std::vector<double> v = Rcpp::as< std::vector<double> >(vin);
-   std::vector<double> rsi;
-   
-   laguerreRSI(v, gamma, rsi);
+   KernelProfile profile(PROFILE_LAGUERRE_BATCH);
+
+   Rcpp::NumericVector x(xIn);
+   Rcpp::NumericVector gammas(gammasIn);
+
+   // The number of rows of a matrix, the length of a vector
+   int rows = Rf_nrows(x);
+   int cols = rows > 0 ? x.size() / rows : 0;
+   int count = gammas.size();
+
+   Rcpp::IntegerVector dims(3);
+   dims[0] = rows;
+   dims[1] = cols;
+   dims[2] = count;
+
+   Rcpp::RObject filter, rsi;
+   double * filterBuffer = NULL;
+   double * rsiBuffer = NULL;
+   std::size_t size = static_cast<std::size_t>(rows)*cols*count;
+   if(withFilter) {
+      Rcpp::NumericVector res(size);
+      res.attr("dim") = dims;
+      filterBuffer = res.begin();
+      filter = res;
+      profile.outputBytes(size*sizeof(double));
+   }
+   if(withRSI) {
+      Rcpp::NumericVector res(size);
+      res.attr("dim") = dims;
+      rsiBuffer = res.begin();
+      rsi = res;
+      profile.outputBytes(size*sizeof(double));
+   }
+
+   // A task per column and block of gammas
+   int blocks = (count + LAGUERRE_LANES - 1) / LAGUERRE_LANES;
+   int tasks = cols*blocks;
+   std::size_t stride = static_cast<std::size_t>(rows)*cols;
+
+   profile.compute();
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(dynamic, 1)
+   for(int tt = 0; tt < tasks; ++tt) {
+      int col = tt % cols;
+      int first = (tt / cols)*LAGUERRE_LANES;
+      int lanes = std::min(LAGUERRE_LANES, count - first);
+
+      DoubleView prices(x.begin() + static_cast<std::size_t>(col)*rows, rows);
+      std::size_t offset = static_cast<std::size_t>(col)*rows + first*stride;
+      laguerreLanes(
+            prices, gammas.begin() + first, lanes,
+            filterBuffer != NULL ? filterBuffer + offset : NULL,
+            rsiBuffer != NULL ? rsiBuffer + offset : NULL,
+            stride);
+   }
+   profile.convert();
+   profile.bars(static_cast<double>(size));
+
+   return Rcpp::List::create(
+               Rcpp::Named("filter") = filter,
+               Rcpp::Named("rsi") = rsi);
+}
+
+// Both the filter and the RSI, from the same pass
+// [[Rcpp::export("laguerre.filter.rsi.interface")]]
+Rcpp::List laguerreFilterRSIInterface(SEXP vin, double gamma, int threads)
+{
+   KernelProfile profile(PROFILE_LAGUERRE_FILTER_RSI);
+
+   Rcpp::NumericVector v(vin);
+   Rcpp::NumericVector filter(v.size());
+   Rcpp::NumericVector rsi(v.size());
+
+   profile.compute();
+   laguerreChunked(doubleView(v), gamma, filter.begin(), rsi.begin(), threads);
+   profile.convert();
+   profile.bars(v.size());
+   profile.outputBytes(2*v.size()*sizeof(double));
+
+   return Rcpp::List::create(
+               Rcpp::Named("filter") = filter,
+               Rcpp::Named("rsi") = rsi);
+}
+
+// The statistics of rolling.window.interface
+enum RollingStat {
+   ROLLING_SUM = 0,
+   ROLLING_MEAN,
+   ROLLING_MIN,
+   ROLLING_MAX
+};
+
+// The rolling kernels below produce an NA for the first n-1 bars and for each
+// window with an NA (thus, after the leading NAs, like TTR). The NaNs are kept
+// out of the running state, they would stick in it otherwise.
+
+// The sum (or the mean) over windows of n bars, in a single pass - the bar which
+// leaves the window is subtracted from the running sum.
+static void rollingSum(const DoubleView & x, std::size_t n, bool mean, double * out)
+{
+   double sum = 0.0;
+   std::size_t nas = 0;
+   for(std::size_t ii = 0; ii < x.size(); ++ii) {
+      if(ISNAN(x[ii])) ++nas;
+      else sum += x[ii];
+
+      if(ii >= n) {
+         if(ISNAN(x[ii-n])) --nas;
+         else sum -= x[ii-n];
+      }
+
+      if(ii + 1 < n || nas > 0) out[ii] = NA_REAL;
+      else out[ii] = mean ? sum / n : sum;
+   }
+}
+
+// The min (Compare is std::less) or the max (std::greater) over windows of n
+// bars. The window is a monotonic deque of indexes: each bar removes the ones
+// it beats from the back, the front is the extreme, until it leaves the window.
+template <typename Compare>
+static void rollingExtreme(const DoubleView & x, std::size_t n, Compare better, double * out)
+{
+   std::deque<std::size_t> window;
+   std::size_t nas = 0;
+   for(std::size_t ii = 0; ii < x.size(); ++ii) {
+      if(ISNAN(x[ii])) {
+         ++nas;
+      } else {
+         while(!window.empty() && !better(x[window.back()], x[ii])) window.pop_back();
+         window.push_back(ii);
+      }
+
+      if(ii >= n && ISNAN(x[ii-n])) --nas;
+      while(!window.empty() && window.front() + n <= ii) window.pop_front();
+
+      out[ii] = ii + 1 < n || nas > 0 ? NA_REAL : x[window.front()];
+   }
+}
+
+// The RSI of returns over windows of n bars: 100 times the sum of the gains over
+// the sum of the gains and the losses (in absolute value). A single pass with
+// both running sums. A sum is reset once its window has no returns left, so
+// the rounding doesn't turn a flat window (0/0) into a value.
+static void returnsRSI(const DoubleView & x, std::size_t n, double * out)
+{
+   double up = 0.0;
+   double down = 0.0;
+   std::size_t gains = 0;
+   std::size_t losses = 0;
+   std::size_t nas = 0;
+   for(std::size_t ii = 0; ii < x.size(); ++ii) {
+      double ret = x[ii];
+      if(ISNAN(ret)) {
+         ++nas;
+      } else if(ret > 0.0) {
+         up += ret;
+         ++gains;
+      } else if(ret < 0.0) {
+         down -= ret;
+         ++losses;
+      }
+
+      if(ii >= n) {
+         double old = x[ii-n];
+         if(ISNAN(old)) {
+            --nas;
+         } else if(old > 0.0) {
+            up = --gains > 0 ? up - old : 0.0;
+         } else if(old < 0.0) {
+            down = --losses > 0 ? down + old : 0.0;
+         }
+      }
+
+      out[ii] = ii + 1 < n || nas > 0 ? NA_REAL : 100.0*up/(up + down);
+   }
+}
+
+// A rolling statistic (see RollingStat) of a vector, or of each column of a
+// matrix, in parallel. The result has the attributes of the input.
+// [[Rcpp::export("rolling.window.interface")]]
+Rcpp::NumericVector rollingWindowInterface(SEXP xIn, int n, int stat, int threads)
+{
+   KernelProfile profile(PROFILE_ROLLING_WINDOW);
+
+   if(n < 1) Rcpp::stop("The window must be positive");
+   if(stat < ROLLING_SUM || stat > ROLLING_MAX) Rcpp::stop("Unknown rolling statistic");
 
-   return Rcpp::NumericVector(rsi.begin(), rsi.end());
-}
\ No newline at end of file
+   Rcpp::NumericVector x(xIn);
+   Rcpp::NumericVector res(Rcpp::clone(x));
+
+   // The number of rows of a matrix, the length of a vector
+   int rows = Rf_nrows(x);
+   int cols = rows > 0 ? x.size() / rows : 0;
+   const double * data = x.begin();
+   double * out = res.begin();
+
+   profile.compute();
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(static)
+   for(int col = 0; col < cols; ++col) {
+      std::size_t offset = static_cast<std::size_t>(col)*rows;
+      DoubleView column(data + offset, rows);
+      switch(stat) {
+      case ROLLING_SUM: rollingSum(column, n, false, out + offset); break;
+      case ROLLING_MEAN: rollingSum(column, n, true, out + offset); break;
+      case ROLLING_MIN: rollingExtreme(column, n, std::less<double>(), out + offset); break;
+      case ROLLING_MAX: rollingExtreme(column, n, std::greater<double>(), out + offset); break;
+      }
+   }
+   profile.convert();
+   profile.bars(x.size());
+   profile.outputBytes(x.size()*sizeof(double));
+
+   return res;
+}
+
+// [[Rcpp::export("returns.rsi.interface")]]
+Rcpp::NumericVector returnsRSIInterface(SEXP xIn, int n, int threads)
+{
+   KernelProfile profile(PROFILE_RETURNS_RSI);
+
+   if(n < 1) Rcpp::stop("The window must be positive");
+
+   Rcpp::NumericVector x(xIn);
+   Rcpp::NumericVector res(Rcpp::clone(x));
+
+   int rows = Rf_nrows(x);
+   int cols = rows > 0 ? x.size() / rows : 0;
+   const double * data = x.begin();
+   double * out = res.begin();
+
+   profile.compute();
+   #pragma omp parallel for num_threads(threadCount(threads)) schedule(static)
+   for(int col = 0; col < cols; ++col) {
+      std::size_t offset = static_cast<std::size_t>(col)*rows;
+      returnsRSI(DoubleView(data + offset, rows), n, out + offset);
+   }
+   profile.convert();
+   profile.bars(x.size());
+   profile.outputBytes(x.size()*sizeof(double));
+
+   return res;
+}